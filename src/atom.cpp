@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#include "atom.h"
+
+#include <string.h>
+#include <assert.h>
+
+
+#define ATOM_STRING_ENTRY(id, str) str,
+#define ATOM_LENGTH_ENTRY(id, str) sizeof(str)-1,
+
+static const char *g_atomStrings[ATOM_COUNT] =
+{
+    "",
+    ATOM_LIST(ATOM_STRING_ENTRY)
+};
+
+static const int g_atomLengths[ATOM_COUNT] =
+{
+    0,
+    ATOM_LIST(ATOM_LENGTH_ENTRY)
+};
+
+#undef ATOM_STRING_ENTRY
+#undef ATOM_LENGTH_ENTRY
+
+
+/**
+ * @brief Creates the table by searching for a multiplier that gives each atom a slot of its own.
+ */
+AtomTable::AtomTable()
+{
+    for(m_multiplier = 2654435761u;;m_multiplier += 2)
+    {
+        bool isPerfect = true;
+        for(int i = 0;i < TABLE_SIZE;i++)
+            m_slots[i] = ATOM_NONE;
+        for(int a = ATOM_NONE+1;a < ATOM_COUNT && isPerfect;a++)
+        {
+            uint32_t slot = (hash(g_atomStrings[a], g_atomLengths[a])*m_multiplier) >> (32-TABLE_BITS);
+            if(m_slots[slot] != ATOM_NONE)
+                isPerfect = false;
+            m_slots[slot] = (Atom)a;
+        }
+        if(isPerfect)
+            break;
+    }
+}
+
+
+AtomTable &AtomTable::getInstance()
+{
+    static AtomTable table;
+    return table;
+}
+
+
+/**
+ * @brief Calculates the hash (FNV-1a) of a string.
+ */
+uint32_t AtomTable::hash(const char *str, int len)
+{
+    uint32_t h = 2166136261u;
+    for(int i = 0;i < len;i++)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+
+/**
+ * @brief Returns the atom of a string (or ATOM_NONE if it is not an atom).
+ */
+Atom AtomTable::lookup(const char *str, int len)
+{
+    return lookup(str, len, hash(str, len));
+}
+
+
+/**
+ * @brief Returns the atom of a string that has already been hashed with hash().
+ */
+Atom AtomTable::lookup(const char *str, int len, uint32_t hash)
+{
+    AtomTable &table = getInstance();
+    Atom atom = table.m_slots[(hash*table.m_multiplier) >> (32-TABLE_BITS)];
+    if(atom != ATOM_NONE && g_atomLengths[atom] == len && memcmp(g_atomStrings[atom], str, len) == 0)
+        return atom;
+    return ATOM_NONE;
+}
+
+
+const char *AtomTable::getString(Atom atom)
+{
+    assert(0 <= atom && atom < ATOM_COUNT);
+    return g_atomStrings[atom];
+}
+
+
+int AtomTable::getLength(Atom atom)
+{
+    assert(0 <= atom && atom < ATOM_COUNT);
+    return g_atomLengths[atom];
+}
+
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#ifndef FILE__ATOM_H
+#define FILE__ATOM_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief The strings that GDB uses as keys and classes in its MI output.
+ */
+#define ATOM_LIST(X) \
+    /* Result classes */ \
+    X(ATOM_DONE,                    "done") \
+    X(ATOM_RUNNING,                 "running") \
+    X(ATOM_CONNECTED,               "connected") \
+    X(ATOM_ERROR,                   "error") \
+    X(ATOM_EXIT,                    "exit") \
+    /* Async classes */ \
+    X(ATOM_STOPPED,                 "stopped") \
+    X(ATOM_THREAD_CREATED,          "thread-created") \
+    X(ATOM_THREAD_GROUP_ADDED,      "thread-group-added") \
+    X(ATOM_THREAD_GROUP_STARTED,    "thread-group-started") \
+    X(ATOM_LIBRARY_LOADED,          "library-loaded") \
+    X(ATOM_BREAKPOINT_CREATED,      "breakpoint-created") \
+    X(ATOM_BREAKPOINT_MODIFIED,     "breakpoint-modified") \
+    X(ATOM_BREAKPOINT_DELETED,      "breakpoint-deleted") \
+    X(ATOM_THREAD_EXITED,           "thread-exited") \
+    X(ATOM_THREAD_GROUP_EXITED,     "thread-group-exited") \
+    X(ATOM_LIBRARY_UNLOADED,        "library-unloaded") \
+    X(ATOM_THREAD_SELECTED,         "thread-selected") \
+    X(ATOM_DOWNLOAD,                "download") \
+    X(ATOM_CMD_PARAM_CHANGED,       "cmd-param-changed") \
+    X(ATOM_MEMORY_CHANGED,          "memory-changed") \
+    /* Stop reasons */ \
+    X(ATOM_BREAKPOINT_HIT,          "breakpoint-hit") \
+    X(ATOM_END_STEPPING_RANGE,      "end-stepping-range") \
+    X(ATOM_SIGNAL_RECEIVED,         "signal-received") \
+    X(ATOM_EXITED_SIGNALLED,        "exited-signalled") \
+    X(ATOM_EXITED_NORMALLY,         "exited-normally") \
+    X(ATOM_FUNCTION_FINISHED,       "function-finished") \
+    X(ATOM_EXITED,                  "exited") \
+    /* Keys */ \
+    X(ATOM_ADDR,                    "addr") \
+    X(ATOM_ARGS,                    "args") \
+    X(ATOM_BKPT,                    "bkpt") \
+    X(ATOM_BKPTNO,                  "bkptno") \
+    X(ATOM_CHANGELIST,              "changelist") \
+    X(ATOM_CHILD,                   "child") \
+    X(ATOM_CHILDREN,                "children") \
+    X(ATOM_CONTENTS,                "contents") \
+    X(ATOM_CORE,                    "core") \
+    X(ATOM_CURRENT_THREAD_ID,       "current-thread-id") \
+    X(ATOM_DISP,                    "disp") \
+    X(ATOM_ENABLED,                 "enabled") \
+    X(ATOM_EXP,                     "exp") \
+    X(ATOM_FILE,                    "file") \
+    X(ATOM_FILES,                   "files") \
+    X(ATOM_FRAME,                   "frame") \
+    X(ATOM_FULLNAME,                "fullname") \
+    X(ATOM_FUNC,                    "func") \
+    X(ATOM_GROUPS,                  "groups") \
+    X(ATOM_HAS_MORE,                "has_more") \
+    X(ATOM_ID,                      "id") \
+    X(ATOM_IN_SCOPE,                "in_scope") \
+    X(ATOM_LEVEL,                   "level") \
+    X(ATOM_LINE,                    "line") \
+    X(ATOM_LOCALS,                  "locals") \
+    X(ATOM_MEMORY,                  "memory") \
+    X(ATOM_MSG,                     "msg") \
+    X(ATOM_NAME,                    "name") \
+    X(ATOM_NUMBER,                  "number") \
+    X(ATOM_NUMCHILD,                "numchild") \
+    X(ATOM_ORIGINAL_LOCATION,       "original-location") \
+    X(ATOM_PID,                     "pid") \
+    X(ATOM_REASON,                  "reason") \
+    X(ATOM_SIGNAL_MEANING,          "signal-meaning") \
+    X(ATOM_SIGNAL_NAME,             "signal-name") \
+    X(ATOM_STACK,                   "stack") \
+    X(ATOM_STATE,                   "state") \
+    X(ATOM_STOPPED_THREADS,         "stopped-threads") \
+    X(ATOM_TARGET_ID,               "target-id") \
+    X(ATOM_THREAD_ID,               "thread-id") \
+    X(ATOM_THREADS,                 "threads") \
+    X(ATOM_TIMES,                   "times") \
+    X(ATOM_TYPE,                    "type") \
+    X(ATOM_TYPE_CHANGED,            "type_changed") \
+    X(ATOM_VALUE,                   "value") \
+    X(ATOM_VARIABLES,               "variables")
+
+
+#define ATOM_ENUM_ENTRY(id, str) id,
+
+enum Atom
+{
+    ATOM_NONE = 0, //!< The string is not in the table.
+    ATOM_LIST(ATOM_ENUM_ENTRY)
+    ATOM_COUNT
+};
+
+#undef ATOM_ENUM_ENTRY
+
+
+/**
+ * @brief Maps the strings in ATOM_LIST to small integer ids.
+ *
+ * The table is a perfect hash, so a lookup costs one hash of the string
+ * and one comparison.
+ */
+class AtomTable
+{
+public:
+    static Atom lookup(const char *str, int len);
+    static Atom lookup(const char *str, int len, uint32_t hash);
+    static const char *getString(Atom atom);
+    static int getLength(Atom atom);
+
+    static uint32_t hash(const char *str, int len);
+
+private:
+    AtomTable();
+    static AtomTable &getInstance();
+
+private:
+    enum { TABLE_BITS = 10, TABLE_SIZE = 1<<TABLE_BITS };
+
+    uint32_t m_multiplier; //!< Chosen so that no atoms shares a slot.
+    Atom m_slots[TABLE_SIZE];
+};
+
+
+#endif // FILE__ATOM_H
+
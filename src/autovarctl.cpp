@@ -16,21 +16,21 @@
 
 AutoVarCtl::AutoVarCtl()
     : m_autoWidget(0)
+    ,m_model(this)
 {
-
+    QStringList names;
+    names += "Name";
+    names += "Value";
+    m_model.setHeaders(names);
 }
 
-QString getTreeWidgetItemPath(QTreeWidgetItem *item)
+
+AutoVarCtl::~AutoVarCtl()
 {
-    QTreeWidgetItem *parent = item->parent();
-    if(parent)
-        return getTreeWidgetItemPath(parent) + "/" + item->text(0);
-    else
-        return item->text(0);
 }
 
 
-void AutoVarCtl::setWidget(QTreeWidget *autoWidget)
+void AutoVarCtl::setWidget(QTreeView *autoWidget)
 {
     m_autoWidget = autoWidget;
 
@@ -38,19 +38,14 @@ void AutoVarCtl::setWidget(QTreeWidget *autoWidget)
     connect(m_autoWidget, SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(onContextMenu(const QPoint&)));
 
     //
-    m_autoWidget->setColumnCount(2);
+    m_autoWidget->setModel(&m_model);
     m_autoWidget->setColumnWidth(0, 120);
-    QStringList names;
-    names.clear();
-    names += "Name";
-    names += "Value";
-    m_autoWidget->setHeaderLabels(names);
-    connect(m_autoWidget, SIGNAL(itemDoubleClicked ( QTreeWidgetItem * , int  )), this,
-                            SLOT(onAutoWidgetItemDoubleClicked(QTreeWidgetItem *, int )));
-    connect(m_autoWidget, SIGNAL(itemExpanded ( QTreeWidgetItem * )), this,
-                            SLOT(onAutoWidgetItemExpanded(QTreeWidgetItem * )));
-    connect(m_autoWidget, SIGNAL(itemCollapsed ( QTreeWidgetItem *  )), this,
-                            SLOT(onAutoWidgetItemCollapsed(QTreeWidgetItem * )));
+    connect(m_autoWidget, SIGNAL(doubleClicked ( const QModelIndex & )), this,
+                            SLOT(onAutoWidgetItemDoubleClicked(const QModelIndex & )));
+    connect(m_autoWidget, SIGNAL(expanded ( const QModelIndex & )), this,
+                            SLOT(onAutoWidgetItemExpanded(const QModelIndex & )));
+    connect(m_autoWidget, SIGNAL(collapsed ( const QModelIndex & )), this,
+                            SLOT(onAutoWidgetItemCollapsed(const QModelIndex & )));
 
 
 }
@@ -59,40 +54,40 @@ void AutoVarCtl::onContextMenu ( const QPoint &pos)
 {
 
     m_popupMenu.clear();
-    
+
     // Add 'open'
     QAction *action = m_popupMenu.addAction("Show memory");
     action->setData(0);
     connect(action, SIGNAL(triggered()), this, SLOT(onShowMemory()));
 
-        
+
     m_popupMenu.popup(m_autoWidget->mapToGlobal(pos));
 }
 
 void AutoVarCtl::onShowMemory()
 {
-    QList<QTreeWidgetItem *> selectedItems = m_autoWidget->selectedItems();
-    if(!selectedItems.empty())
+    QModelIndexList selectedRows = m_autoWidget->selectionModel()->selectedRows();
+    if(!selectedRows.empty())
     {
-        QTreeWidgetItem *item = selectedItems[0];
+        VarItem *item = m_model.getItem(selectedRows[0]);
 
-        long long addr = item->data(1, Qt::UserRole).toLongLong(0);
-        debugMsg("%s addr:%llx\n", stringToCStr(item->text(0)), addr);
+        long long addr = item->m_address;
+        debugMsg("%s addr:%llx\n", stringToCStr(item->m_name), addr);
         if(addr != 0)
         {
-            
+
             MemoryDialog dlg;
             dlg.setConfig(&m_cfg);
             dlg.setStartAddress(addr);
             dlg.exec();
         }
     }
-        
+
 }
 
-void AutoVarCtl::onAutoWidgetItemCollapsed(QTreeWidgetItem *item)
+void AutoVarCtl::onAutoWidgetItemCollapsed(const QModelIndex &index)
 {
-    QString varPath = getTreeWidgetItemPath(item);
+    QString varPath = getItemPath(m_model.getItem(index));
     if(m_autoVarDispInfo.contains(varPath))
     {
         VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varPath];
@@ -101,31 +96,38 @@ void AutoVarCtl::onAutoWidgetItemCollapsed(QTreeWidgetItem *item)
 
 }
 
-void AutoVarCtl::onAutoWidgetItemExpanded(QTreeWidgetItem *item)
+void AutoVarCtl::onAutoWidgetItemExpanded(const QModelIndex &index)
 {
-    QString varPath = getTreeWidgetItemPath(item);
+    VarItem *item = m_model.getItem(index);
+    QString varPath = getItemPath(item);
     if(m_autoVarDispInfo.contains(varPath))
     {
         VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varPath];
         dispInfo.isExpanded = true;
 
     }
+
+    // The view does not fetch the children of items that are expanded
+    // while it has a layout pending.
+    if(item->m_canFetchMore && item->getChildCount() == 0)
+        IVarTreeModel_onFetchMore(item);
 }
 
 
 
 
-void AutoVarCtl::onAutoWidgetItemDoubleClicked(QTreeWidgetItem *item, int column)
+void AutoVarCtl::onAutoWidgetItemDoubleClicked(const QModelIndex &index)
 {
-    if(column == 0)
+    if(index.column() == 0)
     {
     }
-    else if(column == 1)
+    else if(index.column() == 1)
     {
-        QString varName = getTreeWidgetItemPath(item);
-        if(m_autoVarDispInfo.contains(varName))
+        VarItem *item = m_model.getItem(index);
+        QString varPath = getItemPath(item);
+        if(m_autoVarDispInfo.contains(varPath))
         {
-            VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varName];
+            VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varPath];
             if(dispInfo.orgFormat == VarCtl::DISP_DEC)
             {
                 long long val = dispInfo.orgValue.toLongLong(0,0);
@@ -147,127 +149,156 @@ void AutoVarCtl::onAutoWidgetItemDoubleClicked(QTreeWidgetItem *item, int column
                     dispInfo.dispFormat = VarCtl::DISP_DEC;
                 }
 
-                QString valueText = VarCtl::valueDisplay(val, dispInfo.dispFormat);
-
-                item->setText(1, valueText);
+                item->m_value = VarCtl::valueDisplay(val, dispInfo.dispFormat);
+                m_model.itemChanged(item);
             }
         }
     }
 }
 
 
-void AutoVarCtl::ICore_onLocalVarChanged(QString name, CoreVarValue varValue)
+/**
+ * @brief Removes all variables.
+ */
+void AutoVarCtl::clear()
 {
-    Tree *valueTree = varValue.toTree();
-    
-    QTreeWidget *autoWidget = m_autoWidget;
-    QTreeWidgetItem *item;
-    QStringList names;
-
+    m_model.clear();
+    m_items.clear();
+    m_changedItems.clear();
+}
 
-    item = insertTreeWidgetItem(&m_autoVarDispInfo, name, name, varValue.toString());
-    autoWidget->insertTopLevelItem(0, item);
 
-    // Expand it?
-    QString varPath = getTreeWidgetItemPath(item);
-    if(m_autoVarDispInfo.contains(varPath))
-    {
-        VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varPath];
-        if(dispInfo.isExpanded)
-        {
-            autoWidget->expandItem(item);
-        }
-    }
-
-    // Insert children
-    if(valueTree)
+/**
+ * @brief Clears the highlighting of the variables that was changed by the last step.
+ */
+void AutoVarCtl::clearChangedItems()
+{
+    for(int i = 0;i < m_changedItems.size();i++)
     {
-        addVariableDataTree(autoWidget, &m_autoVarDispInfo, item, valueTree->getRoot());
+        VarItem *item = m_changedItems[i];
+        item->m_isChanged = false;
+        m_model.itemChanged(item);
     }
-    
-    delete valueTree;
+    m_changedItems.clear();
 }
 
 
+void AutoVarCtl::ICore_onStateChanged(ICore::TargetState state)
+{
+    if(state == ICore::TARGET_RUNNING)
+        clearChangedItems();
+    else if(state == ICore::TARGET_FINISHED)
+        clear();
+}
 
 
-void AutoVarCtl::addVariableDataTree(
-                QTreeWidget *treeWidget,
-                VarCtl::DispInfoMap *map,
-                QTreeWidgetItem *item, TreeNode *rootNode)
+/**
+ * @brief The variable objects of the locals has been replaced (Eg: another frame was selected).
+ */
+void AutoVarCtl::ICore_onLocalVarReset()
 {
-    QString parentPath = getTreeWidgetItemPath(item);
-
-    item->setText(1, rootNode->getData());
-    item->setData(1, Qt::UserRole, QVariant((qlonglong)rootNode->getAddress()));
+    clear();
+}
 
-    for(int i = 0;i < rootNode->getChildCount();i++)
-    {
-        TreeNode *child = rootNode->getChild(i);
 
-        QString varPath = parentPath + "/" + child->getName();
-        QTreeWidgetItem *childItem;
+/**
+ * @brief Adds a local variable or updates the value of one that has changed.
+ */
+void AutoVarCtl::ICore_onLocalVarChanged(QString varId, QString name, QString value, QString varType, bool hasChildren)
+{
+    VarItem *item = m_items.value(varId, NULL);
 
-        if(child->getChildCount() == 0)
+    // A new variable?
+    if(item == NULL)
+    {
+        // Find the parent (Eg: "l12.a" for "l12.a.b")
+        VarItem *parentItem = m_model.getRoot();
+        int divPos = varId.lastIndexOf('.');
+        if(divPos != -1)
         {
-            childItem = insertTreeWidgetItem(
-                    map,
-                    varPath,
-                    child->getName(),
-                    child->getData());
-
-            childItem->setData(1, Qt::UserRole, QVariant((qlonglong)child->getAddress()));
+            parentItem = m_items.value(varId.left(divPos), NULL);
+            if(parentItem == NULL)
+                return;
+        }
 
-            item->addChild(childItem);
+        item = new VarItem(parentItem);
+        item->m_name = name;
+        item->m_type = varType;
+        item->m_key = varId;
+        item->m_hasChildren = hasChildren;
+        item->m_canFetchMore = hasChildren;
+        m_items[varId] = item;
+        setItemValue(item, value);
+
+        QList<VarItem*> items;
+        items.append(item);
+        m_model.addItems(parentItem, items);
+    }
+    else
+    {
+        setItemValue(item, value);
 
-        }
-        else
+        // Highlight it until the target is started again
+        if(!item->m_isChanged)
         {
-            QStringList names;
-            names += child->getName();
+            item->m_isChanged = true;
+            m_changedItems.append(item);
+        }
+        m_model.itemChanged(item);
+    }
+}
 
-            childItem = new QTreeWidgetItem(names);
-            item->addChild(childItem);
 
-            addVariableDataTree(treeWidget, map, childItem, child);
-        }
+/**
+ * @brief All the locals of a new frame has been added.
+ */
+void AutoVarCtl::ICore_onLocalVarListDone()
+{
+    expandStoredItems(m_model.getRoot(), 0);
+}
 
 
-        // Expand it?
-        if(m_autoVarDispInfo.contains(varPath))
-        {
-            VarCtl::DispInfo &dispInfo = (*map)[varPath];
+/**
+ * @brief Gets the path of an item (Eg: "var1/a/b").
+ *
+ * The display settings are indexed by the path since the variable
+ * objects are recreated each time another frame is selected.
+ */
+QString AutoVarCtl::getItemPath(VarItem *item)
+{
+    QString path = item->m_name;
+    for(VarItem *parent = item->getParent();parent != m_model.getRoot();parent = parent->getParent())
+        path = parent->m_name + "/" + path;
+    return path;
+}
 
-            if(dispInfo.isExpanded)
-            {
-                treeWidget->expandItem(childItem);
-            }
-        }
-        else
-        {
-            // Add it to the dispinfomap
-            VarCtl::DispInfo dispInfo;
-            dispInfo.isExpanded = false;
-            (*map)[varPath] = dispInfo;
-        }
-    }
+
+/**
+ * @brief Gets the address that a pointer value refers to (Eg: '0x601040 "text"').
+ */
+long long AutoVarCtl::parseAddress(QString value)
+{
+    if(!value.startsWith("0x"))
+        return 0;
+    return value.section(' ', 0, 0).toULongLong(0, 0);
 }
 
-        
-QTreeWidgetItem *AutoVarCtl::insertTreeWidgetItem(
-                    VarCtl::DispInfoMap *map,
-                    QString fullPath,
-                    QString name,
-                    QString value)
+
+/**
+ * @brief Sets the value of an item.
+ */
+void AutoVarCtl::setItemValue(VarItem *item, QString value)
 {
     QString displayValue = value;
     VarCtl::DispFormat orgFormat = VarCtl::findVarType(value);
+    QString varPath = getItemPath(item);
 
     //
-    if(map->contains(fullPath))
+    if(m_autoVarDispInfo.contains(varPath))
     {
-        VarCtl::DispInfo &dispInfo = (*map)[fullPath];
+        VarCtl::DispInfo &dispInfo = m_autoVarDispInfo[varPath];
         dispInfo.orgValue = value;
+        dispInfo.orgFormat = orgFormat;
 
         // Update the variable value
         if(orgFormat == VarCtl::DISP_DEC)
@@ -282,27 +313,58 @@ QTreeWidgetItem *AutoVarCtl::insertTreeWidgetItem(
         dispInfo.orgFormat = orgFormat;
         dispInfo.dispFormat = dispInfo.orgFormat;
         dispInfo.isExpanded = false;
-        (*map)[fullPath] = dispInfo;
+        m_autoVarDispInfo[varPath] = dispInfo;
     }
 
-    //
-    QStringList names;
-    names.clear();
-    names += name;
-    names += displayValue;
-    QTreeWidgetItem *item;
-    item = new QTreeWidgetItem(names);
-    item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-
-    return item;
+    item->m_value = displayValue;
+    item->m_address = parseAddress(value);
 }
 
 
-void AutoVarCtl::setConfig(Settings *cfg)
+/**
+ * @brief Gets the next page of children of an item that has been expanded.
+ */
+void AutoVarCtl::IVarTreeModel_onFetchMore(VarItem *item)
 {
-    m_cfg = *cfg;
+    Core &core = Core::getInstance();
+
+    item->m_canFetchMore = false;
+
+    int from = item->getChildCount();
+    item->m_canFetchMore = core.gdbExpandVarWatchChildren(item->m_key, from, PAGE_SIZE);
+
+    expandStoredItems(item, from);
 }
 
 
+void AutoVarCtl::IVarTreeModel_onNameEdited(VarItem *item, QString name)
+{
+    Q_UNUSED(item);
+    Q_UNUSED(name);
+}
+
 
+/**
+ * @brief Expands the children of an item that was expanded the last time they were shown.
+ * @param first    Index of the first child to check.
+ */
+void AutoVarCtl::expandStoredItems(VarItem *parent, int first)
+{
+    for(int i = first;i < parent->getChildCount();i++)
+    {
+        VarItem *child = parent->getChild(i);
+        QString varPath = getItemPath(child);
+        if(!child->m_hasChildren || !m_autoVarDispInfo.contains(varPath))
+            continue;
+        QModelIndex index = m_model.getIndex(child);
+        if(m_autoVarDispInfo[varPath].isExpanded && !m_autoWidget->isExpanded(index))
+            m_autoWidget->expand(index);
+    }
+}
+
+
+void AutoVarCtl::setConfig(Settings *cfg)
+{
+    m_cfg = *cfg;
+}
 
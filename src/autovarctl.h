@@ -9,15 +9,16 @@
 #ifndef FILE__AUTO_VAR_CTL_H
 #define FILE__AUTO_VAR_CTL_H
 
-#include "tree.h"
 #include "core.h"
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QHash>
 #include "varctl.h"
+#include "vartreemodel.h"
 #include <QMenu>
 
 #include "settings.h"
 
-class AutoVarCtl : public VarCtl
+class AutoVarCtl : public VarCtl, public IVarTreeModel
 {
     Q_OBJECT
 public:
@@ -25,41 +26,51 @@ public:
 
 public:
     AutoVarCtl();
+    ~AutoVarCtl();
 
 
-    void setWidget(QTreeWidget *autoWidget);
+    void setWidget(QTreeView *autoWidget);
 
-    void ICore_onLocalVarChanged(QString name, CoreVarValue varValue);
+    void ICore_onStateChanged(ICore::TargetState state);
+    void ICore_onLocalVarReset();
+    void ICore_onLocalVarChanged(QString varId, QString name, QString value, QString varType, bool hasChildren);
+    void ICore_onLocalVarListDone();
+    void clear();
 
     void setConfig(Settings *cfg);
 
+    void IVarTreeModel_onFetchMore(VarItem *item);
+    void IVarTreeModel_onNameEdited(VarItem *item, QString name);
+
 private:
-    void addVariableDataTree(
-                QTreeWidget *treeWidget,
-                VarCtl::DispInfoMap *map,
-                QTreeWidgetItem *item, TreeNode *rootNode);
-    QTreeWidgetItem *insertTreeWidgetItem(
-                    VarCtl::DispInfoMap *map,
-                    QString fullPath,
-                    QString name,
-                    QString value);
-                                
+    enum { PAGE_SIZE = 256 }; //!< Number of children to get from GDB at a time.
+
+    void setItemValue(VarItem *item, QString value);
+    void clearChangedItems();
+    void expandStoredItems(VarItem *parent, int first);
+    QString getItemPath(VarItem *item);
+    static long long parseAddress(QString value);
+
 public slots:
 
     void onContextMenu ( const QPoint &pos);
-    void onAutoWidgetItemCollapsed(QTreeWidgetItem *item);
-    void onAutoWidgetItemExpanded(QTreeWidgetItem *item);
-    void onAutoWidgetItemDoubleClicked(QTreeWidgetItem *item, int column);
+    void onAutoWidgetItemCollapsed(const QModelIndex &index);
+    void onAutoWidgetItemExpanded(const QModelIndex &index);
+    void onAutoWidgetItemDoubleClicked(const QModelIndex &index);
     void onShowMemory();
 
 
-    
+
 public:
-    QTreeWidget *m_autoWidget;
+    QTreeView *m_autoWidget;
     QMenu m_popupMenu;
-    
+
     VarCtl::DispInfoMap m_autoVarDispInfo;
     Settings m_cfg;
+
+    VarTreeModel m_model;
+    QHash<QString, VarItem*> m_items; //!< The items indexed by the id of their variable object.
+    QList<VarItem*> m_changedItems; //!< The items that are highlighted as changed.
 };
 
 
@@ -80,11 +80,13 @@ void CodeView::paintEvent ( QPaintEvent * event )
     painter.fillRect(rect, borderColor);
 
 
-    // Show breakpoints
-    for(int j = 0;j < m_breakpointList.size();j++)
+    // Show breakpoints (on the rows that are repainted)
+    int firstRowIdx = event->rect().top()/rowHeight;
+    int lastRowIdx = event->rect().bottom()/rowHeight;
+    for(int rowIdx = firstRowIdx;rowIdx <= lastRowIdx;rowIdx++)
     {
-        int lineNo = m_breakpointList[j];
-        int rowIdx = lineNo-1;
+        if(!m_breakpointList.contains(rowIdx+1))
+            continue;
         int y = rowHeight*rowIdx;
         QRect rect2(5,y,BORDER_WIDTH-10,rowHeight);
         painter.fillRect(rect2, Qt::blue);
@@ -93,7 +95,7 @@ void CodeView::paintEvent ( QPaintEvent * event )
     
     // Draw content
     painter.setFont(m_font);
-    for(size_t rowIdx = 0;rowIdx < m_highlighter.getRowCount();rowIdx++)
+    for(size_t rowIdx = firstRowIdx;rowIdx < m_highlighter.getRowCount() && (int)rowIdx <= lastRowIdx;rowIdx++)
     {
         //int x = BORDER_WIDTH+10;
         int y = rowHeight*rowIdx;
@@ -287,12 +289,30 @@ void CodeView::mouseDoubleClickEvent( QMouseEvent * event )
 }
 
 
-void CodeView::setBreakpoints(QVector<int> numList)
+void CodeView::setBreakpoints(QList<int> numList)
 {
-    m_breakpointList = numList;
+    m_breakpointList = numList.toSet();
     update();
 }   
 
+
+/**
+ * @brief Adds or removes the breakpoint marker of a line (and only repaints that row).
+ * @param lineNo    The line (1=first row).
+ */
+void CodeView::setBreakpoint(int lineNo, bool isSet)
+{
+    if(isSet == m_breakpointList.contains(lineNo))
+        return;
+    if(isSet)
+        m_breakpointList.insert(lineNo);
+    else
+        m_breakpointList.remove(lineNo);
+
+    int rowHeight = getRowHeight();
+    update(0, rowHeight*(lineNo-1), BORDER_WIDTH, rowHeight);
+}
+
 void CodeView::setConfig(Settings *cfg)
 {
     m_cfg = cfg;
@@ -11,6 +11,7 @@
 
 #include <QWidget>
 #include <QStringList>
+#include <QSet>
 #include "syntaxhighlighter.h"
 #include "settings.h"
 
@@ -46,7 +47,8 @@ public:
     
     void setInterface(ICodeView *inf) { m_inf = inf; };
 
-    void setBreakpoints(QVector<int> numList);
+    void setBreakpoints(QList<int> numList);
+    void setBreakpoint(int lineNo, bool isSet);
 
     int getRowHeight();
     
@@ -60,7 +62,7 @@ public:
     QFontMetrics *m_fontInfo;
     int m_cursorY;
     ICodeView *m_inf;
-    QVector<int> m_breakpointList;
+    QSet<int> m_breakpointList; //!< The lines (first=1) that has a breakpoint.
     SyntaxHighlighter m_highlighter;
     Settings *m_cfg;
 };
@@ -134,13 +134,19 @@ void CodeViewTab::onFuncListItemActivated(int index)
     m_ui.scrollArea_codeView->verticalScrollBar()->setValue(m_ui.codeView->getRowHeight()*lineIdx);
 }
 
-void CodeViewTab::setBreakpoints(const QVector<int> &numList)
+void CodeViewTab::setBreakpoints(const QList<int> &numList)
 {
     m_ui.codeView->setBreakpoints(numList);
     m_ui.codeView->update();
 }
 
 
+void CodeViewTab::setBreakpoint(int lineNo, bool isSet)
+{
+    m_ui.codeView->setBreakpoint(lineNo, isSet);
+}
+
+
 void CodeViewTab::setConfig(Settings *cfg)
 {
     m_ui.codeView->setConfig(cfg);
@@ -34,7 +34,8 @@ public:
 
     void setInterface(ICodeView *inf);
     
-    void setBreakpoints(const QVector<int> &numList);
+    void setBreakpoints(const QList<int> &numList);
+    void setBreakpoint(int lineNo, bool isSet);
 
     QString getFilePath() { return m_filepath; };
     
@@ -13,10 +13,22 @@
 #include "log.h"
 #include "util.h"
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include "config.h"
 
 
+#define READ_BLOCK_SIZE     (64*1024)
+#define LAZY_ROW_SIZE       (64*1024) //!< Rows at least this long are parsed lazily.
+#define LAZY_DEPTH          2 //!< The tuples and lists at this depth are parsed lazily.
+
+
 
 const char* Com::asyncClassToString(ComListener::AsyncClass ac)
 {
@@ -28,25 +40,35 @@ const char* Com::asyncClassToString(ComListener::AsyncClass ac)
         case ComListener::AC_THREAD_GROUP_ADDED:return "thread_group_added";break;
         case ComListener::AC_THREAD_GROUP_STARTED:return "thread_group_started";break;
         case ComListener::AC_LIBRARY_LOADED:return "library_loaded";break;
+        case ComListener::AC_BREAKPOINT_CREATED: return "breakpoint_created";break;
         case ComListener::AC_BREAKPOINT_MODIFIED: return "breakpoint_modified";break;
+        case ComListener::AC_BREAKPOINT_DELETED: return "breakpoint_deleted";break;
         case ComListener::AC_THREAD_EXITED: return "thread_exited";break;
         case ComListener::AC_THREAD_GROUP_EXITED: return "thread_group_exited";break;
         case ComListener::AC_LIBRARY_UNLOADED: return "library_unloaded";break;
         case ComListener::AC_THREAD_SELECTED: return "thread_selected";break;
         case ComListener::AC_DOWNLOAD: return "download";break;
         case ComListener::AC_CMD_PARAM_CHANGED: return "cmd_param_changed";break;
+        case ComListener::AC_MEMORY_CHANGED: return "memory_changed";break;
 
     };
     return "?";
 }
 
     
-const char *Token::toString()
+/**
+ * @brief Returns the text of the token.
+ *
+ * The text of a C string is unescaped first.
+ */
+QString Token::getString() const
 {
-    strcpy(m_tmpBuff, (const char*)stringToCStr(text));
-        
-    return m_tmpBuff;
-};
+    if(m_str == NULL)
+        return text;
+    if(m_type == C_STRING)
+        return unescapeCString(m_str, m_len);
+    return QString::fromUtf8(m_str, m_len);
+}
 
 
 const char *Token::typeToString(Type type)
@@ -70,6 +92,7 @@ const char *Token::typeToString(Type type)
         case KEY_AND:str = "&";break;
         case END_CODE: str = "endcode";break;
         case VAR: str = "var";break;
+        case LAZY_VALUE: str = "lazy_value";break;
     }
     return str;
 }
@@ -81,46 +104,166 @@ bool Resp::isResult()
         return (m_type == RESULT) ? true : false;
 }
 
+
+TokenArena::TokenArena()
+ : m_count(0)
+{
+}
+
+
+TokenArena::~TokenArena()
+{
+    for(int i = 0;i < m_blocks.size();i++)
+        delete [] m_blocks[i];
+}
+
+
+/**
+ * @brief Creates a token which is a view into a row held by the arena.
+ */
+Token *TokenArena::alloc(Token::Type type, const char *str, int len)
+{
+    if(m_count == m_blocks.size()*BLOCK_SIZE)
+        m_blocks.push_back(new Token[BLOCK_SIZE]);
+    Token *tok = &m_blocks[m_count/BLOCK_SIZE][m_count%BLOCK_SIZE];
+    m_count++;
+    tok->setView(type, str, len);
+    return tok;
+}
+
+
+/**
+ * @brief Keeps a (shared) reference to the buffer that tokens will point into.
+ */
+void TokenArena::holdBuffer(const QByteArray &buffer)
+{
+    m_buffers.push_back(buffer);
+}
+
+
+/**
+ * @brief Releases all tokens and rows. The token blocks are kept for reuse.
+ */
+void TokenArena::reset()
+{
+    m_count = 0;
+    m_buffers.clear();
+}
+
+        
+RespQueue::RespQueue()
+{
+    m_head = m_tail = new Node;
+}
+
+
+RespQueue::~RespQueue()
+{
+    Resp *resp;
+    while((resp = pop()) != NULL)
+        delete resp;
+    delete m_head;
+}
+
+
+/**
+ * @brief Adds a response to the end of the queue.
+ */
+void RespQueue::push(Resp *resp)
+{
+    Node *node = new Node;
+    node->m_resp = resp;
+
+    // Publish the node (and the response) to the popping thread
+    m_tail->m_next.fetchAndStoreOrdered(node);
+    m_tail = node;
+}
+
+
+/**
+ * @brief Takes the first response in the queue.
+ * @return The response or NULL if the queue is empty.
+ */
+Resp *RespQueue::pop()
+{
+    Node *next = m_head->m_next.fetchAndAddOrdered(0);
+    if(next == NULL)
+        return NULL;
+    Resp *resp = next->m_resp;
+    next->m_resp = NULL;
+    delete m_head;
+    m_head = next;
+    return resp;
+}
+
         
 Com::Com()
- : m_listener(NULL)
+ : m_gdbPid(0)
+ ,m_gdbStdin(-1)
+ ,m_gdbStdout(-1)
+ ,m_gdbStderr(-1)
+ ,m_listener(NULL)
+ ,m_lastToken(0)
+ ,m_waitToken(0)
+ ,m_waitResult(NULL)
+ ,m_waitResultData(NULL)
+ ,m_stopGeneration(0)
+ ,m_memoEpoch(0)
+ ,m_memoHits(0)
+ ,m_memoMisses(0)
+ ,m_reader(this)
+ ,m_wakeNotifier(NULL)
 #ifdef ENABLE_GDB_LOG
  ,m_logFile(GDB_LOG_FILE)
 #endif
  ,m_busy(0)
  {
-/*
-    QByteArray array = m_process.readAllStandardOutput();
-    qDebug() << "--->>";
-    qDebug() << QString(array);
-    qDebug() << "---<<";
-*/
-
 
 #ifdef ENABLE_GDB_LOG
      m_logFile.open(QIODevice::Truncate | QIODevice::WriteOnly | QIODevice::Text);
 #endif
 
-    connect(&m_process, SIGNAL(readyReadStandardOutput ()), this, SLOT(onReadyReadStandardOutput()));
-
+    // Create the pipe used by the reader thread to wake us up
+    if(pipe(m_wakeFds) != 0)
+    {
+        errorMsg("Failed to create pipe (%s)", strerror(errno));
+        m_wakeFds[0] = m_wakeFds[1] = -1;
+    }
+    else
+    {
+        fcntl(m_wakeFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(m_wakeFds[1], F_SETFL, O_NONBLOCK);
+        
+        m_wakeNotifier = new QSocketNotifier(m_wakeFds[0], QSocketNotifier::Read, this);
+        connect(m_wakeNotifier, SIGNAL(activated(int)), this, SLOT(onRespReceived()));
+    }
 }
 
 Com::~Com()
 {
-    // Send the command to gdb to exit cleanly
-    QString text = "-gdb-exit\n";
-    m_process.write((const char*)text.toLatin1());
-    
-    
-    m_process.terminate();
+    if(m_gdbPid != 0)
+    {
+        // Send the command to gdb to exit cleanly
+        writeToGdb("-gdb-exit\n");
+        close(m_gdbStdin);
+        m_gdbStdin = -1;
+
+        kill(m_gdbPid, SIGTERM);
+        waitpid(m_gdbPid, NULL, 0);
+
+        // The reader thread quits when the output from GDB is closed
+        m_reader.wait();
+        close(m_gdbStdout);
+        close(m_gdbStderr);
+    }
 
-    m_process.waitForFinished();
-    
-    // Free tokens
-    while(!m_freeTokens.isEmpty())
+    clearMemo();
+
+    delete m_wakeNotifier;
+    if(m_wakeFds[0] != -1)
     {
-        Token *token = m_freeTokens.takeFirst();
-        delete token;
+        close(m_wakeFds[0]);
+        close(m_wakeFds[1]);
     }
 }
 
@@ -140,159 +283,178 @@ GdbResult Com::commandF(Tree *resultData, const char *cmdFmt, ...)
 }
 
 
+int Com::commandAsyncF(ComResultListener *listener, const char *cmdFmt, ...)
+{
+    va_list ap;
+    char buffer[1024];
+
+    va_start(ap, cmdFmt);
+    vsnprintf(buffer, sizeof(buffer), cmdFmt, ap);
+
+    int token = commandAsync(listener, buffer);
+    va_end(ap);
+
+    return token;
+}
+
+
 
 /**
- * @brief Creates tokens from a single GDB output row.
+ * @brief Finds the end of the tuple or list that starts at str[i] (Eg: '{a="}",b=[]}').
+ * @return Index of the closing bracket (or len if there is none).
  */
-QList<Token*> Com::tokenize(QString str)
+static int findValueEnd(const char *str, int i, int len)
 {
-    enum { IDLE, END_CODE, STRING, VAR} state = IDLE;
-    QList<Token*> list;
-    Token *cur = NULL;
-    QChar prevC = ' ';
-    
-    if(str.isEmpty())
-        return list;
-
-    for(int i = 0;i < str.size();i++)
+    int depth = 0;
+    while(i < len)
     {
-        QChar c = str[i];
-        switch(state)
+        char c = str[i];
+        if(c == '"')
         {
-            case IDLE:
+            // Skip the string
+            i++;
+            while(i < len && str[i] != '"')
             {
-                if(c == '"')
-                {
-                    cur = new Token(Token::C_STRING);
-                    list.push_back(cur);
-                    state = STRING;
-                }
-                else if(c == '(')
-                {
-                    cur = new Token(Token::END_CODE);
-                    list.push_back(cur);
-                    cur->text += c;
-                    state = END_CODE;
-                }
-                else if(c == '=' || c == '{' || c == '}' || c == ',' ||
-                    c == '[' || c == ']' || c == '+' || c == '^' ||
-                    c == '~' || c == '@' || c == '&' || c == '*')
-                {
-                    Token::Type type = Token::UNKNOWN;
-                    if(c == '=')
-                        type = Token::KEY_EQUAL;
-                    if(c == '{')
-                        type = Token::KEY_LEFT_BRACE;
-                    if(c == '}')
-                        type = Token::KEY_RIGHT_BRACE;
-                    if(c == '[')
-                        type = Token::KEY_LEFT_BAR;
-                    if(c == ']')
-                        type = Token::KEY_RIGHT_BAR;
-                    if(c == ',')
-                        type = Token::KEY_COMMA;
-                    if(c == '^')
-                        type = Token::KEY_UP;
-                    if(c == '+')
-                        type = Token::KEY_PLUS;
-                    if(c == '~')
-                        type = Token::KEY_TILDE;
-                    if(c == '@')
-                        type = Token::KEY_SNABEL;
-                    if(c == '&')
-                        type = Token::KEY_AND;
-                    if(c == '*')
-                        type = Token::KEY_STAR;
-                    cur = new Token(type);
-                    list.push_back(cur);
-                    cur->text += c;
-                    state = IDLE;
-                }
-                else if( c != ' ')
-                {
-                    cur = new Token(Token::VAR);
-                    list.push_back(cur);
-                    cur->text = c;
-                    state = VAR;
-                }
-                
-            };break;
-            case END_CODE:
-            {
-                QString codeEndStr = "(gdb)";
-                cur->text += c;
+                if(str[i] == '\\')
+                    i++;
+                i++;
+            }
+        }
+        else if(c == '{' || c == '[')
+            depth++;
+        else if(c == '}' || c == ']')
+        {
+            if(--depth == 0)
+                return i;
+        }
+        i++;
+    }
+    return len;
+}
 
-                if(cur->text.length() == codeEndStr.length())
-                {
-                    state = IDLE;
-                    
-                }
-                else if(cur->text.compare(codeEndStr.left(cur->text.length())) != 0)
-                {
-                    cur->setType(Token::VAR);
-                    state = IDLE;
-                }
-                
-            };break;
-            case STRING:
+
+/**
+ * @brief Returns the type of the token made up of a single character (or UNKNOWN).
+ */
+static Token::Type getCharTokenType(char c)
+{
+    switch(c)
+    {
+        case '=': return Token::KEY_EQUAL;
+        case '{': return Token::KEY_LEFT_BRACE;
+        case '}': return Token::KEY_RIGHT_BRACE;
+        case '[': return Token::KEY_LEFT_BAR;
+        case ']': return Token::KEY_RIGHT_BAR;
+        case ',': return Token::KEY_COMMA;
+        case '^': return Token::KEY_UP;
+        case '+': return Token::KEY_PLUS;
+        case '~': return Token::KEY_TILDE;
+        case '@': return Token::KEY_SNABEL;
+        case '&': return Token::KEY_AND;
+        case '*': return Token::KEY_STAR;
+        default: return Token::UNKNOWN;
+    }
+}
+
+
+/**
+ * @brief Creates tokens from a single GDB output row.
+ *
+ * The tokens are views into the row, so the row must be kept alive (see
+ * TokenArena::holdBuffer) for as long as the tokens are used.
+ *
+ * @param lazyDepth   Tuples and lists nested this deep are returned as a
+ *                    single LAZY_VALUE token (or 0 to tokenize everything).
+ */
+void Com::tokenize(TokenArena *arena, const char *str, int len, int lazyDepth)
+{
+    // Command token?
+    int depth = 0;
+    int i = 0;
+    while(i < len && isdigit(str[i]))
+        i++;
+    if(i > 0)
+        arena->alloc(Token::VAR, str, i);
+        
+    while(i < len)
+    {
+        char c = str[i];
+        if(c == ' ' || c == '\r')
+        {
+            i++;
+        }
+        else if(c == '"')
+        {
+            // Find the end of the string
+            int end = i+1;
+            while(end < len && str[end] != '"')
             {
-                if(prevC != '\\' && c == '\\')
-                {
-                }
-                else if(prevC == '\\')
-                {
-                    if(c == 'n')
-                        cur->text += '\n';
-                    else
-                        cur->text += c;
-                }
-                else if(c == '"')
-                    state = IDLE;
-                else
-                    cur->text += c;
-            };break;
-            case VAR:
+                if(str[end] == '\\')
+                    end++;
+                end++;
+            }
+            if(end > len)
+                end = len;
+            arena->alloc(Token::C_STRING, str+i+1, end-(i+1));
+            i = end+1;
+        }
+        else if(c == '(' && len-i >= 5 && strncmp(str+i, "(gdb)", 5) == 0)
+        {
+            arena->alloc(Token::END_CODE, str+i, 5);
+            i += 5;
+        }
+        else if((c == '{' || c == '[') && depth+1 == lazyDepth)
+        {
+            // Keep the whole tuple or list as a single token
+            int end = findValueEnd(str, i, len);
+            arena->alloc(Token::LAZY_VALUE, str+i, (end < len ? end+1 : len)-i);
+            i = end+1;
+        }
+        else if(getCharTokenType(c) != Token::UNKNOWN)
+        {
+            if(c == '{' || c == '[')
+                depth++;
+            else if((c == '}' || c == ']') && depth > 0)
+                depth--;
+            arena->alloc(getCharTokenType(c), str+i, 1);
+            i++;
+        }
+        else
+        {
+            int end = i+1;
+            while(end < len && str[end] != '=' && str[end] != ',' &&
+                    str[end] != '{' && str[end] != '}')
             {
-                if(c == '=' || c == ',' || c == '{' || c == '}')
-                {
-                    i--;
-                    cur->text = cur->text.trimmed();
-                    state = IDLE;
-                }
-                else
-                    cur->text += c;
-            };break;
-            
+                end++;
+            }
+
+            // Trim trailing whitespaces
+            int varLen = end-i;
+            while(varLen > 0 && (str[i+varLen-1] == ' ' || str[i+varLen-1] == '\r'))
+                varLen--;
+            Token *tok = arena->alloc(Token::VAR, str+i, varLen);
+            tok->setAtom(AtomTable::lookup(str+i, varLen));
+            i = end;
         }
-        prevC = c;
-    }
-    if(cur)
-    {
-        if(cur->getType() == Token::VAR)
-            cur->text = cur->text.trimmed();
     }
-    return list;
 }
 
-Token* Com::pop_token()
+Token* ComParser::pop_token()
 {
-    if(m_list.empty())
+    if(m_tokenIdx >= m_tokens.count())
         return NULL;
-    Token *tok = m_list.takeFirst();
-    m_freeTokens += tok;    
+    Token *tok = m_tokens.at(m_tokenIdx++);
     //debugMsg(">%s", stringToCStr(tok->getString()));
     return tok;
 }
 
 
-Token* Com::peek_token()
+Token* ComParser::peek_token()
 {
-    readTokens();
-    
-    if(m_list.empty())
+    if(m_tokenIdx >= m_tokens.count())
         return NULL;
         
-    return m_list.first();
+    return m_tokens.at(m_tokenIdx);
 }
 
 
@@ -311,64 +473,29 @@ int Com::parseAsyncOutput(Resp *resp, ComListener::AsyncClass *ac)
     {
         return -1;
     }
-    QString acString = tokVar->getString();
-    
-    if(acString == "stopped")
-    {
-        *ac = ComListener::AC_STOPPED;
-    }
-    else if(acString == "running")
-    {
-        *ac = ComListener::AC_RUNNING;
-    }
-    else if(acString == "thread-created")
-    {
-        *ac = ComListener::AC_THREAD_CREATED;
-    }
-    else if(acString == "thread-group-added")
-    {
-        *ac = ComListener::AC_THREAD_GROUP_ADDED;
-    }
-    else if(acString == "thread-group-started")
-    {
-        *ac = ComListener::AC_THREAD_GROUP_STARTED;
-    }
-    else if(acString == "library-loaded")
-    {
-        *ac = ComListener::AC_LIBRARY_LOADED;
-    }
-    else if(acString == "breakpoint-modified")
-    {
-        *ac = ComListener::AC_BREAKPOINT_MODIFIED;
-    }
-    else if(acString == "thread-exited")
-    {
-        *ac = ComListener::AC_THREAD_EXITED;
-    }
-    else if(acString == "thread-group-exited")
-    {
-        *ac = ComListener::AC_THREAD_GROUP_EXITED;
-    }
-    else if(acString == "library-unloaded")
-    {
-        *ac = ComListener::AC_LIBRARY_UNLOADED;
-    }
-    else if(acString == "thread-selected")
-    {
-        *ac = ComListener::AC_THREAD_SELECTED;
-    }
-    else if(acString == "download")
-    {
-        *ac = ComListener::AC_DOWNLOAD;
-    }
-    else if(acString == "cmd-param-changed")
+    switch(tokVar->getAtom())
     {
-        *ac = ComListener::AC_CMD_PARAM_CHANGED;
-    }
-    else
-    {
-        warnMsg("Unexpected response '%s'", stringToCStr(acString));
-        assert(0);
+        case ATOM_STOPPED: *ac = ComListener::AC_STOPPED;break;
+        case ATOM_RUNNING: *ac = ComListener::AC_RUNNING;break;
+        case ATOM_THREAD_CREATED: *ac = ComListener::AC_THREAD_CREATED;break;
+        case ATOM_THREAD_GROUP_ADDED: *ac = ComListener::AC_THREAD_GROUP_ADDED;break;
+        case ATOM_THREAD_GROUP_STARTED: *ac = ComListener::AC_THREAD_GROUP_STARTED;break;
+        case ATOM_LIBRARY_LOADED: *ac = ComListener::AC_LIBRARY_LOADED;break;
+        case ATOM_BREAKPOINT_CREATED: *ac = ComListener::AC_BREAKPOINT_CREATED;break;
+        case ATOM_BREAKPOINT_MODIFIED: *ac = ComListener::AC_BREAKPOINT_MODIFIED;break;
+        case ATOM_BREAKPOINT_DELETED: *ac = ComListener::AC_BREAKPOINT_DELETED;break;
+        case ATOM_THREAD_EXITED: *ac = ComListener::AC_THREAD_EXITED;break;
+        case ATOM_THREAD_GROUP_EXITED: *ac = ComListener::AC_THREAD_GROUP_EXITED;break;
+        case ATOM_LIBRARY_UNLOADED: *ac = ComListener::AC_LIBRARY_UNLOADED;break;
+        case ATOM_THREAD_SELECTED: *ac = ComListener::AC_THREAD_SELECTED;break;
+        case ATOM_DOWNLOAD: *ac = ComListener::AC_DOWNLOAD;break;
+        case ATOM_CMD_PARAM_CHANGED: *ac = ComListener::AC_CMD_PARAM_CHANGED;break;
+        case ATOM_MEMORY_CHANGED: *ac = ComListener::AC_MEMORY_CHANGED;break;
+        default:
+        {
+            warnMsg("Unexpected response '%s'", stringToCStr(tokVar->getString()));
+            assert(0);
+        };break;
     }
 
 
@@ -455,11 +582,11 @@ Resp *Com::parseNotifyAsyncOutput()
 Resp *Com::parseAsyncRecord()
 {
     Resp *resp = NULL;
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseExecAsyncOutput();
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseStatusAsyncOutput();
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseNotifyAsyncOutput();
     return resp;
 }
@@ -476,7 +603,8 @@ Resp *Com::parseStreamRecord()
         tok = eatToken(Token::C_STRING);
 
         resp->setType(Resp::CONSOLE_STREAM_OUTPUT);
-        resp->setString(tok->getString());
+        if(tok)
+            resp->setString(tok->getString());
         
     }
     else if(checkToken(Token::KEY_SNABEL))
@@ -485,7 +613,8 @@ Resp *Com::parseStreamRecord()
         tok = eatToken(Token::C_STRING);
 
         resp->setType(Resp::TARGET_STREAM_OUTPUT);
-        resp->setString(tok->getString());
+        if(tok)
+            resp->setString(tok->getString());
         
     }
     else if(checkToken(Token::KEY_AND))
@@ -494,7 +623,8 @@ Resp *Com::parseStreamRecord()
         tok = eatToken(Token::C_STRING);
 
         resp->setType(Resp::LOG_STREAM_OUTPUT);
-        resp->setString(tok->getString());
+        if(tok)
+            resp->setString(tok->getString());
         
     }
 
@@ -503,15 +633,9 @@ Resp *Com::parseStreamRecord()
 
 
 
-Token* Com::eatToken(Token::Type type)
+Token* ComParser::eatToken(Token::Type type)
 {
     Token *tok = peek_token();
-    while(tok == NULL)
-    {
-        m_process.waitForReadyRead(100);
-        readTokens();
-        tok = peek_token();
-    }
     if(tok == NULL || tok->getType() != type)
     {
         errorMsg("Expected '%s' but got '%s'",
@@ -524,9 +648,9 @@ Token* Com::eatToken(Token::Type type)
 
 
 /**
- * @brief Checks if the read queue is empty.
+ * @brief Checks if there are tokens left to parse on the current row.
  */
-bool Com::isTokenPending()
+bool ComParser::isTokenPending()
 {
     Token *tok = peek_token();
     if(tok == NULL)
@@ -542,11 +666,9 @@ bool Com::isTokenPending()
  * @brief Checks and pops a token if the kind is as expected.
  * @return The found token or NULL if no hit.
  */
-Token* Com::checkToken(Token::Type type)
+Token* ComParser::checkToken(Token::Type type)
 {
     Token *tok = peek_token();
-    if(tok == NULL)
-        readTokens();
     if(tok == NULL || tok->getType() != type)
     {
         return NULL;
@@ -560,7 +682,7 @@ Token* Com::checkToken(Token::Type type)
  * @brief Parses 'VALUE'
  * @return 0 on success.
  */
-int Com::parseValue(TreeNode *item)
+int ComParser::parseValue(TreeNode *item)
 {
     Token *tok;
     int rc = 0;
@@ -570,7 +692,12 @@ int Com::parseValue(TreeNode *item)
     // Const?
     if(tok->getType() == Token::C_STRING)
     {
-        item->setData(tok->getString());
+        item->setData(tok->getStr(), tok->getLength(), true);
+    }
+    // Tuple or list that is parsed when it is accessed?
+    else if(tok->getType() == Token::LAZY_VALUE)
+    {
+        item->setLazyValue(tok->getStr(), tok->getLength());
     }
     // Tuple?
     else if(tok->getType() == Token::KEY_LEFT_BRACE)
@@ -609,10 +736,9 @@ int Com::parseValue(TreeNode *item)
 
             do
             {
-                TreeNode *node = new TreeNode;
+                TreeNode *node = item->addChild();
                 name.sprintf("%d", idx++);
                 node->setName(name);
-                item->addChild(node); 
                 rc = parseValue(node);
             } while(checkToken(Token::KEY_COMMA) != NULL);
             
@@ -633,10 +759,9 @@ int Com::parseValue(TreeNode *item)
  * @brief Parses 'RESULT'
  * @return 0 on success.
  */
-int Com::parseResult(TreeNode *parent)
+int ComParser::parseResult(TreeNode *parent)
 {
-    TreeNode *item = new TreeNode;
-    parent->addChild(item);
+    TreeNode *item = parent->addChild();
 
 
     Token *tok = peek_token();
@@ -651,7 +776,10 @@ int Com::parseResult(TreeNode *parent)
         Token *tokVar = eatToken(Token::VAR);
         if(tokVar == NULL)
             return -1;
-        item->setName(tokVar->getString());
+        if(tokVar->getAtom() != ATOM_NONE)
+            item->setName(tokVar->getAtom());
+        else
+            item->setName(tokVar->getStr(), tokVar->getLength());
         
         //
         if(eatToken(Token::KEY_EQUAL) == NULL)
@@ -665,16 +793,9 @@ int Com::parseResult(TreeNode *parent)
 
 Resp *Com::parseResultRecord()
 {
-    Token *tokVar;
     Resp *resp = NULL;
     int rc = 0;
     
-    // Parse 'token'
-    tokVar = checkToken(Token::VAR);
-    if(tokVar)
-    {
-    }
-
     // Parse '^'
     if(checkToken(Token::KEY_UP) == NULL)
         return NULL;
@@ -687,23 +808,20 @@ Resp *Com::parseResultRecord()
         return NULL;
 
     resp = new Resp;
-    QString resultClass = tok->getString();
     GdbResult res;
-    if(resultClass == "done")
-        res = GDB_DONE;
-    else if(resultClass == "running")
-        res = GDB_RUNNING;
-    else if(resultClass == "connected")
-        res = GDB_CONNECTED;
-    else if(resultClass == "error")
-        res = GDB_ERROR;
-    else if(resultClass == "exit")
-        res = GDB_EXIT;
-    else
+    switch(tok->getAtom())
     {
-        delete resp;
-        errorMsg("Invalid result class found: %s", stringToCStr(resultClass));
-        return NULL;
+        case ATOM_DONE: res = GDB_DONE;break;
+        case ATOM_RUNNING: res = GDB_RUNNING;break;
+        case ATOM_CONNECTED: res = GDB_CONNECTED;break;
+        case ATOM_ERROR: res = GDB_ERROR;break;
+        case ATOM_EXIT: res = GDB_EXIT;break;
+        default:
+        {
+            delete resp;
+            errorMsg("Invalid result class found: %s", stringToCStr(tok->getString()));
+            return NULL;
+        }
     }
     resp->m_result = res;
     
@@ -714,13 +832,6 @@ Resp *Com::parseResultRecord()
         rc = parseResult(resp->tree.getRoot());
     }
 
-    if(!m_pending.isEmpty())
-    {
-        PendingCommand cmd = m_pending.takeFirst();
-
-        debugMsg("%s done", stringToCStr(cmd.m_cmdText));
-    }
-
     resp->setType(Resp::RESULT);
 
     return resp;
@@ -732,26 +843,81 @@ Resp* Com::parseOutOfBandRecord()
 {
     Resp *resp = NULL;
     
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseAsyncRecord();
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseStreamRecord();
 
     return resp;
 }
 
     
+/**
+ * @brief Parses the next complete row received from GDB.
+ * @return The response or NULL if no complete row has been received yet.
+ */
 Resp *Com::parseOutput()
 {
     Resp *resp = NULL;
+    int cmdToken = 0;
+    const char *row;
+    int rowLen;
+    
+    // Get the next complete row
+    if(!m_lineBuffer.takeLine(&row, &rowLen))
+        return NULL;
+    if(rowLen == 0)
+        return NULL;
+
+    debugMsg("row:%.*s", rowLen, row);
+ 
+#ifdef ENABLE_GDB_LOG
+    m_logMutex.lock();
+    m_logFile.write(">> ", 3);
+    m_logFile.write(row, rowLen);
+    m_logFile.write("\n", 1);
+    m_logFile.flush();
+    m_logMutex.unlock();
+#endif
+
+    // Skip the command token
+    int tokenLen = 0;
+    while(tokenLen < rowLen-1 && isdigit(row[tokenLen]))
+        tokenLen++;
+        
+    char firstChar = row[tokenLen];
+    if(firstChar != '(' &&
+        firstChar != '^' &&
+        firstChar != '*' &&
+        firstChar != '+' &&
+        firstChar != '~' &&
+        firstChar != '@' &&
+        firstChar != '&' &&
+        firstChar != '=')
+    {
+        // Not a record so it must be output from the target
+        resp = new Resp;
+        resp->setType(Resp::TARGET_STREAM_OUTPUT);
+        resp->setString(QString::fromUtf8(row, rowLen));
+        return resp;
+    }
+    
+    // The tokens and the tree refer to the row in the line buffer
+    bool isLazy = rowLen >= LAZY_ROW_SIZE;
+    tokenize(&m_parser.m_tokens, row, rowLen, isLazy ? LAZY_DEPTH : 0);
+
+    // Parse 'token'
+    Token *tokVar = checkToken(Token::VAR);
+    if(tokVar)
+        cmdToken = tokVar->getString().toInt();
     
     if(isTokenPending())
         resp = parseOutOfBandRecord();
 
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
         resp = parseResultRecord();
             
-    if(isTokenPending() && resp == NULL)
+    if(resp == NULL && isTokenPending())
     {
         resp = new Resp;
         Token *token = checkToken(Token::END_CODE);
@@ -767,259 +933,672 @@ Resp *Com::parseOutput()
     if(token)
         errorMsg("Unexpected token '%s'", stringToCStr(token->getString()));
 */
+
+    // Drop anything left on the row
+    releaseTokens();
+
+    if(resp)
+    {
+        resp->m_token = cmdToken;
+        resp->tree.holdBuffer(m_lineBuffer.getBuffer());
+        if(isLazy)
+            resp->tree.setSubtreeParser(&m_subtreeParser);
+    }
+    
     return resp;
 }
 
 
 /**
- * @brief Reads output from GDB.
+ * @brief Parses the text of a lazy node (Eg: '{name="a",value="1"}').
+ */
+void ComParser::parseSubtree(TreeNode *node, const char *str, int len)
+{
+    Com::tokenize(&m_tokens, str, len);
+    parseValue(node);
+    releaseTokens();
+}
+
+
+/**
+ * @brief Releases the tokens of the row being parsed.
  */
-void Com::readTokens()
+void ComParser::releaseTokens()
+{
+    m_tokens.reset();
+    m_tokenIdx = 0;
+}
+
+
+void ComReader::run()
 {
-    m_inputBuffer += m_process.readAllStandardOutput();
+    m_com->readerLoop();
+}
 
-    // Any characters received?
-    while(m_inputBuffer.size() > 0)
+
+/**
+ * @brief Reads and parses the output from GDB until GDB exits.
+ *
+ * Runs in the reader thread. The parsed responses are handed over to the
+ * GUI thread through m_readQueue.
+ */
+void Com::readerLoop()
+{
+    struct pollfd fds[2];
+    int fdCount = 2;
+
+    fds[0].fd = m_gdbStdout;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_gdbStderr;
+    fds[1].events = POLLIN;
+    
+    while(1)
     {
-        // Newline received?
-        int subLen = m_inputBuffer.indexOf('\n');
-        if(subLen != -1)
+        if(poll(fds, fdCount, -1) < 0)
         {
-            QString row = QString(m_inputBuffer.left(subLen));
-            m_inputBuffer = m_inputBuffer.mid(subLen+1);
+            if(errno == EINTR)
+                continue;
+            errorMsg("Failed to wait for GDB output (%s)", strerror(errno));
+            break;
+        }
 
-            if(!row.isEmpty())
+        // Dump all stderr content
+        if(fdCount > 1 && fds[1].revents != 0)
+        {
+            char stderrBuffer[1024];
+            int readLen = read(m_gdbStderr, stderrBuffer, sizeof(stderrBuffer));
+            if(readLen <= 0)
+                fdCount = 1;
+            else
             {
-                debugMsg("row:%s", stringToCStr(row));
-     
-#ifdef ENABLE_GDB_LOG
-                QString logText;
-                logText = ">> ";
-                logText += row;
-                logText += "\n";
-                m_logFile.write(stringToCStr(logText), logText.length());
-                m_logFile.flush();
-#endif
-
-                QList<Token*> list;
-                char firstChar = row[0].toLatin1();
-                if(firstChar == '(' ||
-                    firstChar == '^' ||
-                    firstChar == '*' ||
-                    firstChar == '+' ||
-                    firstChar == '~' ||
-                    firstChar == '@' ||
-                    firstChar == '&' ||
-                    firstChar == '=')
-                {
-                    list = tokenize(row);
-                    m_list += list;
-                }
-                else if(m_listener)
+                QString respString = QString::fromUtf8(stderrBuffer, readLen);
+                QStringList respList = respString.split("\n");
+                for(int r = 0;r < respList.size();r++)
                 {
-                    m_listener->onTargetStreamOutput(row);
+                    QString row = respList[r];
+                    if(!row.isEmpty())
+                        debugMsg("GDB|E>%s", stringToCStr(row));
                 }
             }
         }
 
-        // Half a line received?
-        if(m_inputBuffer.isEmpty() == false)
+        if(fds[0].revents != 0)
         {
-            int timeout = 20;
-            // Wait for the complete line to be received
-            while(m_inputBuffer.indexOf('\n') == -1)
+            // Read directly into the line buffer
+            int buffLen;
+            char *buff = m_lineBuffer.getWriteBuffer(READ_BLOCK_SIZE, &buffLen);
+            int readLen = read(m_gdbStdout, buff, buffLen);
+            if(readLen < 0 && errno == EINTR)
+                continue;
+            if(readLen <= 0)
+                break;
+            m_lineBuffer.commitWrite(readLen);
+
+            // Parse all complete rows
+            bool received = false;
+            while(m_lineBuffer.hasLine())
             {
-                m_process.waitForReadyRead(100);
-                m_inputBuffer += m_process.readAllStandardOutput();
-                timeout--;
-                assert(timeout > 0);
+                Resp *resp = parseOutput();
+                if(resp)
+                {
+                    m_readQueue.push(resp);
+                    received = true;
+                }
             }
+            if(received)
+                wakeGuiThread();
         }
+    }
 
+    debugMsg("GDB output closed");
+    wakeGuiThread();
+}
+
+
+/**
+ * @brief Tells the GUI thread that there are responses to take from m_readQueue.
+ */
+void Com::wakeGuiThread()
+{
+    char c = 0;
+    if(write(m_wakeFds[1], &c, 1) < 0)
+    {
+        // The pipe is full so the GUI thread will wake up anyway
     }
 }
 
-    
-void Com::readFromGdb(GdbResult *m_result, Tree *m_resultData)
+
+/**
+ * @brief Waits for the reader thread to parse more responses.
+ * @param timeout    Max time to wait in milliseconds.
+ */
+void Com::waitForReader(int timeout)
 {
-    
-    //debugMsg("## '%s'",stringToCStr(row));
+    struct pollfd fds;
+    fds.fd = m_wakeFds[0];
+    fds.events = POLLIN;
+    poll(&fds, 1, timeout);
+
+    // Empty the wakeup pipe
+    char buff[64];
+    while(read(m_wakeFds[0], buff, sizeof(buff)) > 0)
+    {
+    }
+}
 
-    Resp *resp = NULL;
 
-    
-    if(m_result == NULL)
+/**
+ * @brief Takes a response from the reader thread and queues it for dispatch.
+ */
+void Com::queueResp(Resp *resp)
+{
+    // Find the command that the result belongs to
+    if(resp->getType() == Resp::RESULT && !m_pending.isEmpty())
     {
-        
-        // Parse any data received from GDB
-        resp = parseOutput();
-        if(resp == NULL)
-            m_process.waitForReadyRead(100);
-       
-        
-        while(!m_freeTokens.isEmpty())
+        // (The memoized results was never sent to GDB)
+        int idx = 0;
+        while(idx < m_pending.size() &&
+            (m_pending[idx].m_memoResp != NULL ||
+            (resp->m_token != 0 && m_pending[idx].m_token != resp->m_token)))
         {
-            Token *token = m_freeTokens.takeFirst();
-            delete token;
+            idx++;
         }
-
-        if(resp)
+        if(idx < m_pending.size())
         {
-            m_respQueue.push_back(resp);
+            PendingCommand cmd = m_pending.takeAt(idx);
+            resp->m_resultListener = cmd.m_listener;
 
-            if(resp->getType() == Resp::RESULT)
+            // Keep the result for the rest of the stop
+            // (unless the memo was cleared while the command was in flight, Eg: by -stack-select-frame)
+            if(cmd.m_isMemoizable && resp->m_result == GDB_DONE && cmd.m_memoEpoch == m_memoEpoch)
             {
-                assert(m_resultData != NULL);
-            
-                m_resultData->copy(resp->tree);
+                MemoEntry *entry = new MemoEntry;
+                entry->m_tree.share(resp->tree);
+                delete m_memo.value(cmd.m_cmdText, NULL);
+                m_memo[cmd.m_cmdText] = entry;
             }
-        }
 
+            debugMsg("%s done", stringToCStr(cmd.m_cmdText));
+        }
     }
-    else
+    // The target has been started or stopped?
+    else if(resp->getType() == Resp::EXEC_ASYNC_OUTPUT)
     {
-    do
-    {
-        
-        // Parse any data received from GDB
-        do
-        {
-            resp = parseOutput();
-            if(resp == NULL)
-                m_process.waitForReadyRead(100);
-        }while(resp == NULL);
-       
-        
-        while(!m_freeTokens.isEmpty())
-        {
-            Token *token = m_freeTokens.takeFirst();
-            delete token;
-        }
+        debugMsg("Stop generation %d: %d memo hits, %d misses", m_stopGeneration, m_memoHits, m_memoMisses);
+
+        m_stopGeneration++;
+        clearMemo();
+    }
+
+    m_respQueue.push_back(resp);
+    claimResult(resp);
+
+    takeMemoResps();
+}
 
 
+/**
+ * @brief Queues the memoized results that are next in turn.
+ *
+ * The results are dispatched in the same order as the commands was sent,
+ * so a memoized result waits for the results of the commands before it.
+ */
+void Com::takeMemoResps()
+{
+    while(!m_pending.isEmpty() && m_pending[0].m_memoResp != NULL)
+    {
+        PendingCommand cmd = m_pending.takeFirst();
+        Resp *resp = cmd.m_memoResp;
+        resp->m_resultListener = cmd.m_listener;
+
         m_respQueue.push_back(resp);
+        claimResult(resp);
+    }
+}
 
-        
-        if(resp->getType() == Resp::RESULT)
-        {
-            assert(m_resultData != NULL);
-            
-            if(m_result)
-                *m_result = resp->m_result;
-            m_resultData->copy(resp->tree);
-        }
 
-    }while(m_result != NULL && resp->getType() != Resp::TERMINATION);
+/**
+ * @brief Hands over a result to the one waiting for it in waitForResult().
+ */
+void Com::claimResult(Resp *resp)
+{
+    if(m_waitToken == 0 || resp->getType() != Resp::RESULT || resp->m_token != m_waitToken)
+        return;
+
+    if(m_waitResult)
+        *m_waitResult = resp->m_result;
+
+    // Hand over the tree to the caller when it has been dispatched
+    resp->m_resultData = m_waitResultData;
+}
+
+
+/**
+ * @brief Stops handing over results to waitForResult().
+ */
+void Com::clearWait()
+{
+    m_waitToken = 0;
+    m_waitResult = NULL;
+    m_waitResultData = NULL;
 }
 
-    //  debugMsg("# ---<< \n");
 
+/**
+ * @brief Forgets all memoized results.
+ *
+ * The results of the commands in flight are not memoized either since
+ * they may have been produced before the change.
+ */
+void Com::clearMemo()
+{
+    m_memoEpoch++;
+
+    QHash<QString, MemoEntry*>::const_iterator itr = m_memo.constBegin();
+    for(;itr != m_memo.constEnd();++itr)
+        delete itr.value();
+    m_memo.clear();
+}
 
-//for(int i = 0;i < m_respQueue.size();i++)
+    
+/**
+ * @brief Takes all responses parsed by the reader thread (without waiting for more).
+ */
+void Com::readFromGdb()
 {
-//    debugMsg("%d > %s", i, stringToCStr(m_respQueue[i].getString()));
+    Resp *resp;
+    while((resp = m_readQueue.pop()) != NULL)
+        queueResp(resp);
 }
 
- 
-    // Dump all stderr content
-    QByteArray stderrBuffer = m_process.readAllStandardError();
-    if(!stderrBuffer.isEmpty())
+
+/**
+ * @brief Blocks until the result of a command has been received.
+ * @param token       The token of the command or 0 to wait for all commands sent.
+ * @param result      Set to the result class of the command (may be NULL).
+ * @param resultData  Set to the result of the command (may be NULL).
+ */
+void Com::waitForResult(int token, GdbResult *result, Tree *resultData)
+{
+    Resp *resp = NULL;
+
+    m_waitToken = token;
+    m_waitResult = result;
+    m_waitResultData = resultData;
+
+    // Answered with a memoized result already?
+    for(int i = 0;i < m_respQueue.size();i++)
+        claimResult(m_respQueue[i]);
+    if(!isCommandPending(token))
+    {
+        clearWait();
+        return;
+    }
+
+    do
     {
-        QString respString = QString(stderrBuffer);
-        QStringList respList = respString.split("\n");
-        for(int r = 0;r < respList.size();r++)
+        resp = m_readQueue.pop();
+        if(resp == NULL)
         {
-            QString row = respList[r];
-            if(!row.isEmpty())
-                debugMsg("GDB|E>%s", stringToCStr(row));
+            // Has GDB exited?
+            if(m_reader.isFinished())
+            {
+                resp = m_readQueue.pop();
+                if(resp == NULL)
+                {
+                    errorMsg("GDB has exited");
+                    clearWait();
+                    return;
+                }
+            }
+            else
+            {
+                waitForReader(100);
+                continue;
+            }
         }
-    } 
+            
+        queueResp(resp);
+
+    }while(resp == NULL || resp->getType() != Resp::TERMINATION || isCommandPending(token));
+
+    clearWait();
 }
 
 
+
 GdbResult Com::command(Tree *resultData, QString text)
 {
-    Tree resultDataNull;
-
     assert(m_busy == 0);
     
-    m_busy++;
+    GdbResult result = GDB_ERROR;
+#ifdef ENABLE_DEBUGMSG
+    int allocCount = TreeNode::getAllocCount();
+#endif
     
-    if(resultData == NULL)
-        resultData = &resultDataNull;
+    if(resultData)
+        resultData->removeAll();
+
+    int token = commandAsync(NULL, text);
+
+    m_busy++;
     
-    debugMsg("# Cmd: '%s'", stringToCStr(text));
+    waitForResult(token, &result, resultData);
+
+    // Take anything else received 
+    readFromGdb();
+
+    m_busy--;
 
-    GdbResult result;
     
-    assert(resultData != NULL);
+    dispatchResp();
 
-    resultData->removeAll();
+    onRespReceived();
 
+#ifdef ENABLE_DEBUGMSG
+    debugMsg("# Done: '%s' (%d tree nodes created)", stringToCStr(text),
+            TreeNode::getAllocCount()-allocCount);
+#endif
     
-    //
+    return result;
+}
+
+
+// Commands whose result only depends on the state of the stopped target
+static const char *g_memoCommands[] =
+{
+    "-thread-info",
+    "-list-thread-groups",
+    "-stack-list-frames",
+    "-stack-info-frame",
+    "-stack-list-locals",
+    "-stack-list-arguments",
+    NULL
+};
+
+// Commands that does not change what the commands above returns
+static const char *g_readOnlyCommands[] =
+{
+    "-var-update",
+    "-var-create",
+    "-var-delete",
+    "-var-list-children",
+    "-var-evaluate-expression",
+    "-break-",
+    "-data-read-memory",
+    "-file-list-exec-source-files",
+    NULL
+};
+
+
+/**
+ * @brief Checks if a command is one of the commands in a table.
+ */
+static bool isCommandIn(QString text, const char **table)
+{
+    for(int i = 0;table[i] != NULL;i++)
+    {
+        QString name = table[i];
+        if(text.startsWith(name) &&
+            (text.length() == name.length() || name.endsWith("-") || text[name.length()] == ' '))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Checks if the result of a command can be reused until the target is started again.
+ */
+static bool isMemoizable(QString text)
+{
+    return isCommandIn(text, g_memoCommands);
+}
+
+
+/**
+ * @brief Checks if a command leaves the memoized results valid (Eg: it does not select another frame).
+ */
+static bool isReadOnly(QString text)
+{
+    return isCommandIn(text, g_memoCommands) || isCommandIn(text, g_readOnlyCommands);
+}
+
+
+/**
+ * @brief Sends a command to GDB without waiting for the result.
+ *
+ * The command is prefixed with a unique token. Any number of commands may
+ * be in flight at the same time and the result of each one is passed on
+ * to the listener (as well as to the ComListener) once it is received.
+ * @param listener   Listener to receive the result (may be NULL).
+ * @return The token of the command.
+ */
+int Com::commandAsync(ComResultListener *listener, QString text)
+{
     PendingCommand cmd;
+    cmd.m_token = ++m_lastToken;
     cmd.m_cmdText = text;
+    cmd.m_listener = listener;
+    cmd.m_memoEpoch = m_memoEpoch;
+
+    // Asked for already during this stop?
+    if(isMemoizable(text))
+    {
+        MemoEntry *entry = m_memo.value(text, NULL);
+        if(entry)
+        {
+            m_memoHits++;
+            debugMsg("# Memoized: %d'%s'", cmd.m_token, stringToCStr(text));
+
+            Resp *resp = new Resp;
+            resp->setType(Resp::RESULT);
+            resp->m_token = cmd.m_token;
+            resp->m_result = entry->m_result;
+            resp->tree.share(entry->m_tree);
+            cmd.m_memoResp = resp;
+            m_pending.push_back(cmd);
+
+            takeMemoResps();
+            return cmd.m_token;
+        }
+        m_memoMisses++;
+        cmd.m_isMemoizable = true;
+    }
+    else if(!isReadOnly(text))
+        clearMemo();
+
     m_pending.push_back(cmd);
 
+    debugMsg("# Cmd: %d'%s'", cmd.m_token, stringToCStr(text));
+
     // Send the command to gdb
-    text += "\n";
-    m_process.write((const char*)text.toLatin1());
+    QString line;
+    line.sprintf("%d", cmd.m_token);
+    line += text + "\n";
+    writeToGdb(line.toLatin1());
 
 #ifdef ENABLE_GDB_LOG
     //
     QString logText;
     logText = "\n<< ";
-    logText += text + "\n";
+    logText += line + "\n";
+    m_logMutex.lock();
     m_logFile.write(stringToCStr(logText), logText.length());
     m_logFile.flush();
+    m_logMutex.unlock();
 #endif
 
+    return cmd.m_token;
+}
+
 
-    do
+/**
+ * @brief Writes raw characters to the stdin of GDB.
+ */
+void Com::writeToGdb(QByteArray data)
+{
+    const char *buff = data.constData();
+    int len = data.size();
+
+    if(m_gdbStdin == -1)
+        return;
+        
+    while(len > 0)
     {
-        readFromGdb(&result,resultData);
+        int writeLen = write(m_gdbStdin, buff, len);
+        if(writeLen < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            errorMsg("Failed to write to GDB (%s)", strerror(errno));
+            return;
+        }
+        buff += writeLen;
+        len -= writeLen;
+    }
+}
 
-    }while(!m_pending.isEmpty());
 
-    
-    while(!m_list.isEmpty())
+/**
+ * @brief Blocks until the results of all commands sent has been received and dispatched.
+ */
+void Com::waitForCommands()
+{
+    assert(m_busy == 0);
+
+    // Only memoized results?
+    if(m_pending.isEmpty())
     {
-        readFromGdb(NULL,resultData);
+        dispatchResp();
+        return;
     }
-     
+    
+    m_busy++;
+
+    waitForResult(0, NULL, NULL);
+
+    // Take anything else received 
+    readFromGdb();
 
     m_busy--;
 
-    
     dispatchResp();
 
-    onReadyReadStandardOutput();
-    
-    return result;
+    onRespReceived();
 }
 
 
+/**
+ * @brief Checks if a command is still waiting for its result.
+ * @param token    The token of the command or 0 to check for any command.
+ */
+bool Com::isCommandPending(int token)
+{
+    if(token == 0)
+        return !m_pending.isEmpty();
+    for(int i = 0;i < m_pending.size();i++)
+    {
+        if(m_pending[i].m_token == token)
+            return true;
+    }
+    return false;
+}
+
+
+
+/**
+ * @brief Starts GDB and the thread that reads the output from it.
+ * @return 0 on success.
+ */
 int Com::init(QString gdbPath)
 {
-    QString commandLine;
-    commandLine.sprintf("%s --interpreter=mi2", stringToCStr(gdbPath));
-    
-    m_process.start(commandLine);//gdb ./testapp/test");
-    m_process.waitForStarted();
+    int inPipe[2];
+    int outPipe[2];
+    int errPipe[2];
+    int execPipe[2];
+
+    // Build the argument list before forking
+    QStringList argList = gdbPath.split(' ', QString::SkipEmptyParts);
+    argList += "--interpreter=mi2";
+    QList<QByteArray> args;
+    for(int i = 0;i < argList.size();i++)
+        args += argList[i].toLocal8Bit();
+    QVector<char*> argv;
+    for(int i = 0;i < args.size();i++)
+        argv += args[i].data();
+    argv += NULL;
+
+    if(pipe(inPipe) != 0 || pipe(outPipe) != 0 || pipe(errPipe) != 0 || pipe(execPipe) != 0)
+    {
+        errorMsg("Failed to create pipes (%s)", strerror(errno));
+        return 1;
+    }
+    fcntl(execPipe[1], F_SETFD, FD_CLOEXEC);
 
-    if(m_process.state() == QProcess::NotRunning)
+    // Writing to GDB after it has exited must not kill us
+    signal(SIGPIPE, SIG_IGN);
+    
+    m_gdbPid = fork();
+    if(m_gdbPid == 0)
+    {
+        dup2(inPipe[0], STDIN_FILENO);
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+        close(inPipe[0]);
+        close(inPipe[1]);
+        close(outPipe[0]);
+        close(outPipe[1]);
+        close(errPipe[0]);
+        close(errPipe[1]);
+        close(execPipe[0]);
+
+        execvp(argv[0], argv.data());
+
+        // Tell the parent why exec failed
+        int err = errno;
+        if(write(execPipe[1], &err, sizeof(err)) < 0)
+        {
+        }
+        _exit(127);
+    }
+    close(inPipe[0]);
+    close(outPipe[1]);
+    close(errPipe[1]);
+    close(execPipe[1]);
+    m_gdbStdin = inPipe[1];
+    m_gdbStdout = outPipe[0];
+    m_gdbStderr = errPipe[0];
+
+    // Did GDB start?
+    int err = 0;
+    int readLen = m_gdbPid < 0 ? 0 : read(execPipe[0], &err, sizeof(err));
+    close(execPipe[0]);
+    if(m_gdbPid < 0 || readLen == sizeof(err))
     {
+        errorMsg("Failed to start '%s' (%s)", stringToCStr(gdbPath),
+                strerror(m_gdbPid < 0 ? errno : err));
+        if(m_gdbPid > 0)
+            waitpid(m_gdbPid, NULL, 0);
+        m_gdbPid = 0;
+        close(m_gdbStdin);
+        close(m_gdbStdout);
+        close(m_gdbStderr);
+        m_gdbStdin = m_gdbStdout = m_gdbStderr = -1;
         return 1;
     }
 
+    m_reader.start();
+    
     return 0;
 }
 
 
 int Com::getPid()
 {
-    return m_process.pid();
+    return m_gdbPid;
 }
 
 
@@ -1030,19 +1609,22 @@ Com& Com::getInstance()
 }
 
 
-void Com::onReadyReadStandardOutput ()
+/**
+ * @brief Called (once per event loop iteration) when the reader thread has parsed responses.
+ */
+void Com::onRespReceived()
 {
     if(m_busy != 0)
         return;
 
-
-    while(m_process.bytesAvailable() || m_list.isEmpty() == false)
+    // Empty the wakeup pipe
+    char buff[64];
+    while(read(m_wakeFds[0], buff, sizeof(buff)) > 0)
     {
-        Tree resultDataNull;
-        readFromGdb(NULL, &resultDataNull);
-
-        assert(m_pending.isEmpty() == true);
     }
+
+    // Take whatever has been received
+    readFromGdb();
     
     dispatchResp();
 
@@ -1075,6 +1657,12 @@ void Com::dispatchResp()
             if(resp->getType() == Resp::RESULT)
                 m_listener->onResult(resp->tree);
         }
+        if(resp->getType() == Resp::RESULT && resp->m_resultListener)
+            resp->m_resultListener->onCommandResult(resp->m_token, resp->m_result, resp->tree);
+
+        // Move the tree to the one waiting for it
+        if(resp->m_resultData)
+            resp->m_resultData->swap(resp->tree);
         delete resp;
     }
 
@@ -10,12 +10,20 @@
 #define FILE__COM_H
 
 
-#include <QProcess>
 #include <QList>
+#include <QHash>
+#include <QVector>
 #include <QFile>
+#include <QThread>
+#include <QSocketNotifier>
+#include <QAtomicPointer>
+#include <QMutex>
 #include <assert.h>
+#include <sys/types.h>
 #include "tree.h"
 #include "config.h"
+#include "linebuffer.h"
+#include "atom.h"
 
 
 class Token
@@ -38,24 +46,98 @@ class Token
             KEY_STAR,
             KEY_AND,
             END_CODE,
-            VAR
+            VAR,
+            LAZY_VALUE
         };
     public:
 
-        Token(Type type) : m_type(type) {};
+        Token() : m_type(UNKNOWN), m_str(NULL), m_len(0), m_atom(ATOM_NONE) {};
+        Token(Type type) : m_type(type), m_str(NULL), m_len(0), m_atom(ATOM_NONE) {};
     
         static const char *typeToString(Type type);
         Type getType() const { return m_type; };
         void setType(Type type) { m_type = type; };
-        QString getString() const { return text; };
+        QString getString() const;
 
-        const char *toString();
+        void setView(Type type, const char *str, int len) { m_type = type; m_str = str; m_len = len; m_atom = ATOM_NONE; };
+        const char *getStr() const { return m_str; };
+        int getLength() const { return m_len; };
+        void setAtom(Atom atom) { m_atom = atom; };
+        Atom getAtom() const { return m_atom; };
 
     private:
         Type m_type;
-        char m_tmpBuff[128];
+        const char *m_str; //!< The (still escaped) text in the row the token was found in.
+        int m_len;
+        Atom m_atom; //!< The atom of a VAR token (or ATOM_NONE).
     public:
-        QString text;
+        QString text; //!< The text of tokens that are not a view into a row.
+};
+
+
+/**
+ * @brief Storage for the tokens of the response currently being parsed.
+ *
+ * Tokens are handed out from fixed size blocks which are kept between
+ * responses, so a token never moves once created and all of them are
+ * released at once by reset().
+ */
+class TokenArena
+{
+    public:
+        TokenArena();
+        ~TokenArena();
+
+        Token *alloc(Token::Type type, const char *str, int len);
+        Token *at(int idx) const { return &m_blocks[idx/BLOCK_SIZE][idx%BLOCK_SIZE]; };
+        int count() const { return m_count; };
+
+        void holdBuffer(const QByteArray &buffer);
+        void reset();
+
+    private:
+        enum { BLOCK_SIZE = 1024 };
+        
+        QVector<Token*> m_blocks;
+        int m_count;
+        QList<QByteArray> m_buffers; //!< The rows that the tokens points into.
+
+    private:
+        TokenArena(const TokenArena &) {};
+};
+
+
+
+/**
+ * @brief Parses MI values from the tokens of a row.
+ *
+ * The reader thread uses one instance to parse the rows. The GUI thread
+ * uses another to parse the lazy subtrees of the responses once they are
+ * accessed.
+ */
+class ComParser : public SubtreeParser
+{
+    public:
+        ComParser() : m_tokenIdx(0) {};
+
+        void parseSubtree(TreeNode *node, const char *str, int len);
+
+        Token* pop_token();
+        Token* peek_token();
+        Token* checkToken(Token::Type type);
+        Token* eatToken(Token::Type type);
+        bool isTokenPending();
+        void releaseTokens();
+
+        int parseResult(TreeNode *parent);
+        int parseValue(TreeNode *item);
+
+    public:
+        TokenArena m_tokens; //!< Tokens of the row being parsed.
+        int m_tokenIdx; //!< Index of the next token to parse in m_tokens.
+
+    private:
+        ComParser(const ComParser &) : SubtreeParser() {};
 };
 
 
@@ -76,13 +158,16 @@ private:
             AC_THREAD_GROUP_ADDED,
             AC_THREAD_GROUP_STARTED,
             AC_LIBRARY_LOADED,
+            AC_BREAKPOINT_CREATED,
             AC_BREAKPOINT_MODIFIED,
+            AC_BREAKPOINT_DELETED,
             AC_THREAD_EXITED,
             AC_THREAD_GROUP_EXITED,
             AC_LIBRARY_UNLOADED,
             AC_THREAD_SELECTED,
             AC_DOWNLOAD,
-            AC_CMD_PARAM_CHANGED
+            AC_CMD_PARAM_CHANGED,
+            AC_MEMORY_CHANGED
         };
 
 
@@ -106,21 +191,54 @@ enum GdbResult
 };
 
 
+/**
+ * @brief Receives the result of a command sent with Com::commandAsync().
+ */
+class ComResultListener
+{
+    public:
+        virtual void onCommandResult(int token, GdbResult result, Tree &tree) = 0;
+};
+
+
+class Resp;
+
+
 class PendingCommand
 {
     public:
-        PendingCommand() {};
+        PendingCommand() : m_token(0), m_listener(NULL), m_isMemoizable(false), m_memoEpoch(0), m_memoResp(NULL) {};
 
+        int m_token; //!< The token that the command was prefixed with.
         QString m_cmdText;
+        ComResultListener *m_listener; //!< Listener for the result (or NULL).
+        bool m_isMemoizable; //!< True if the result should be memoized.
+        int m_memoEpoch; //!< The memo epoch that the command was sent in (see Com::clearMemo()).
+        Resp *m_memoResp; //!< The memoized result (or NULL if the command was sent to GDB).
+
+};
 
 
+/**
+ * @brief A memoized result of a command (see Com::commandAsync()).
+ */
+class MemoEntry
+{
+    public:
+        MemoEntry() : m_result(GDB_DONE) {};
+
+        GdbResult m_result;
+        Tree m_tree;
+
+    private:
+        MemoEntry(const MemoEntry &) {};
 };
 
 
 class Resp
 {
     public:
-        Resp() : m_type(UNKNOWN) {};
+        Resp() : m_type(UNKNOWN), m_token(0), m_resultListener(NULL), m_resultData(NULL) {};
 
         typedef enum {
             UNKNOWN = 0,
@@ -151,8 +269,63 @@ class Resp
         Tree tree;
         ComListener::AsyncClass reason;
         GdbResult m_result;
+        int m_token; //!< The token that the record was prefixed with (or 0).
+        ComResultListener *m_resultListener; //!< Listener of the command that the result belongs to.
+        Tree *m_resultData; //!< Where to move the tree once the response has been dispatched (or NULL).
+
+    private:
+        Resp(const Resp &) {};
+};
+
+
+/**
+ * @brief Lock-free queue for handing over responses from one thread to another.
+ *
+ * Only one thread may push and only one (other) thread may pop.
+ */
+class RespQueue
+{
+    public:
+        RespQueue();
+        ~RespQueue();
+
+        void push(Resp *resp);
+        Resp *pop();
+
+    private:
+        class Node
+        {
+            public:
+                Node() : m_resp(NULL), m_next(NULL) {};
+                
+                Resp *m_resp;
+                QAtomicPointer<Node> m_next;
+        };
         
-        
+        Node *m_head; //!< Node before the first entry (only used by the popping thread).
+        Node *m_tail; //!< The last entry (only used by the pushing thread).
+
+    private:
+        RespQueue(const RespQueue &) {};
+};
+
+
+class Com;
+
+
+/**
+ * @brief Thread that reads and parses the output from GDB.
+ */
+class ComReader : public QThread
+{
+    public:
+        ComReader(Com *com) : m_com(com) {};
+
+    protected:
+        void run();
+
+    private:
+        Com *m_com;
 };
 
 
@@ -163,6 +336,8 @@ class Com : public QObject
 
         Q_OBJECT;
 
+        friend class ComReader;
+        
         Com();
         ~Com();
 
@@ -181,7 +356,16 @@ class Com : public QObject
         GdbResult commandF(Tree *resultData, const char *cmd, ...);
         GdbResult command(Tree *resultData, QString cmd);
 
-        static QList<Token*> tokenize(QString str);
+        int commandAsyncF(ComResultListener *listener, const char *cmd, ...);
+        int commandAsync(ComResultListener *listener, QString cmd);
+        void waitForCommands();
+        bool isCommandPending(int token = 0);
+
+        int getStopGeneration() const { return m_stopGeneration; };
+        int getMemoHitCount() const { return m_memoHits; };
+        int getMemoMissCount() const { return m_memoMisses; };
+
+        static void tokenize(TokenArena *arena, const char *str, int len, int lazyDepth = 0);
 
     private:
         int parseAsyncOutput(Resp *resp, ComListener::AsyncClass *ac);
@@ -190,41 +374,73 @@ class Com : public QObject
         Resp *parseNotifyAsyncOutput();
         Resp *parseOutOfBandRecord();
         Resp *parseOutput();
-        int parseResult(TreeNode *parent);
+        int parseResult(TreeNode *parent) { return m_parser.parseResult(parent); };
         Resp *parseResultRecord();
         Resp *parseStatusAsyncOutput();
         Resp *parseStreamRecord();
-        int parseValue(TreeNode *item);
+        int parseValue(TreeNode *item) { return m_parser.parseValue(item); };
 
 
 
-    public slots:
-        void onReadyReadStandardOutput ();
+    private slots:
+        void onRespReceived();
 
 
     private:
-        void readFromGdb(GdbResult *m_result, Tree *m_resultData);
+        void readerLoop();
+        void wakeGuiThread();
+        void waitForReader(int timeout);
+        void queueResp(Resp *resp);
+        void writeToGdb(QByteArray data);
+        void readFromGdb();
+        void waitForResult(int token, GdbResult *result, Tree *resultData);
+        void claimResult(Resp *resp);
+        void clearWait();
+        void takeMemoResps();
+        void clearMemo();
         void decodeGdbResponse();
-        Token* pop_token();
-        Token* peek_token();
-        Token* checkToken(Token::Type type);
-        Token* eatToken(Token::Type type);
+        Token* pop_token() { return m_parser.pop_token(); };
+        Token* peek_token() { return m_parser.peek_token(); };
+        Token* checkToken(Token::Type type) { return m_parser.checkToken(type); };
+        Token* eatToken(Token::Type type) { return m_parser.eatToken(type); };
         void dispatchResp();
-        bool isTokenPending();
-        void readTokens();
+        bool isTokenPending() { return m_parser.isTokenPending(); };
+        void releaseTokens() { m_parser.releaseTokens(); };
         
     private:
-        QProcess m_process;
-        QList<Resp*> m_respQueue; //!< List of responses received from GDB
-        QList<PendingCommand> m_pending;
+        pid_t m_gdbPid;
+        int m_gdbStdin;
+        int m_gdbStdout;
+        int m_gdbStderr;
+        
         ComListener *m_listener;
+        QList<Resp*> m_respQueue; //!< List of responses received from GDB waiting to be dispatched.
+        QList<PendingCommand> m_pending; //!< Commands sent to GDB that has not got a result yet.
+        int m_lastToken; //!< The token used for the last command.
+        int m_waitToken; //!< The command that waitForResult() is waiting for (or 0).
+        GdbResult *m_waitResult;
+        Tree *m_waitResultData;
+        QHash<QString, MemoEntry*> m_memo; //!< Results of side-effect free commands indexed by the command text.
+        int m_stopGeneration; //!< Advanced each time the target is started or stopped.
+        int m_memoEpoch; //!< Advanced each time the memoized results are cleared.
+        int m_memoHits; //!< Number of commands answered with a memoized result.
+        int m_memoMisses; //!< Number of memoizable commands sent to GDB.
+        ComParser m_subtreeParser; //!< Parses the lazy subtrees of the responses.
+
+        // Only used by the reader thread
+        ComReader m_reader;
+        ComParser m_parser; //!< Parser of the rows.
+        LineBuffer m_lineBuffer; //!< Characters received from the GDB process.
+
+        // Handover from the reader thread
+        RespQueue m_readQueue; //!< Responses parsed by the reader thread.
+        int m_wakeFds[2]; //!< Pipe used to wake up the GUI thread.
+        QSocketNotifier *m_wakeNotifier;
         
-        QList<Token*> m_freeTokens; //!< List of tokens allocated but not in use.
-        QList<Token*> m_list;
 #ifdef ENABLE_GDB_LOG
         QFile m_logFile;
+        QMutex m_logMutex;
 #endif
-        QByteArray m_inputBuffer; //!< List of raw characters received from the GDB process.
         int m_busy;
 };
 
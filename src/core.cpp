@@ -11,88 +11,66 @@
 #include "ini.h"
 #include "util.h"
 #include "log.h"
-#include "gdbmiparser.h"
 
 #include <QByteArray>
 #include <QDebug>
 #include <unistd.h>
+#include <fcntl.h>
 #include <assert.h>
 #include <signal.h>
 
 
+#define TARGET_OUTPUT_BUFFER_SIZE   (4*1024*1024) //!< Max number of target output bytes waiting for the GUI.
+#define TARGET_OUTPUT_READ_SIZE     (64*1024)
+#define TARGET_OUTPUT_MAX_READ      (1024*1024) //!< Max number of bytes read before letting other events in.
+#define TARGET_OUTPUT_INTERVAL      20 //!< How often (in ms) the target output is passed on to the GUI.
+
+#define MEMORY_PAGE_SIZE            4096
+#define MEMORY_READ_AHEAD_PAGES     4 //!< Number of extra pages to read before and after the ones asked for.
+#define MEMORY_CACHE_MAX_PAGES      2048
+
+
+// Paths looked up for every child in the results from GDB
+static const TreePath g_pathName("name");
+static const TreePath g_pathValue("value");
+static const TreePath g_pathExp("exp");
+static const TreePath g_pathType("type");
+static const TreePath g_pathNumChild("numchild");
+static const TreePath g_pathHasMore("has_more");
+static const TreePath g_pathFile("file");
+static const TreePath g_pathFullname("fullname");
+static const TreePath g_pathFilename("filename");
+static const TreePath g_pathSources("sources");
+static const TreePath g_pathDebugInfo("debug-info");
+static const TreePath g_pathFunc("func");
+static const TreePath g_pathLine("line");
+static const TreePath g_pathId("id");
+static const TreePath g_pathTargetId("target-id");
+static const TreePath g_pathFrameFunc("frame/func");
+static const TreePath g_pathFrameArgs("frame/args");
+static const TreePath g_pathReason("reason");
+static const TreePath g_pathInScope("in_scope");
+static const TreePath g_pathMemory("memory");
+static const TreePath g_pathBegin("begin");
+static const TreePath g_pathEnd("end");
+static const TreePath g_pathContents("contents");
+static const TreePath g_pathAddr("addr");
+static const TreePath g_pathLen("len");
 
 
-
-QString CoreVarValue::toString()
-{
-    if(m_str.startsWith("{<"))
-    {
-        // Is it a message? Eg: "{<No data fields>}".
-        return m_str.mid(1,m_str.length()-2);
-    }
-    
-    return m_str;
-}
-
-
-
-
-Tree* CoreVarValue::toTree()
+/**
+ * @brief Checks if a GDB variable object belongs to a local variable (rather than to a watch).
+ */
+static bool isLocalVarId(QString varId)
 {
-    Tree *tree = NULL;
-    
-    QList<Token*> tokenList = GdbMiParser::tokenizeVarString(m_str);
-
-    QList<Token*> orgList = tokenList;
-
-    if(tokenList.size() > 1)
-    {
-        Token* token;
-        token = tokenList.front();
-
-        if(token)
-        {
-            TreeNode *rootNode;
-            tree = new Tree;
-            rootNode = tree->getRoot();
-
-            // Is it a "@0x2202:" type?
-            if(token->getType() == Token::KEY_SNABEL)
-            {
-                Token *extraNameTok;
-                token = tokenList.takeFirst();
-                
-                extraNameTok = tokenList.takeFirst();
-                if(extraNameTok)
-                {
-                 
-                    rootNode->setAddress(extraNameTok->getString().toInt(0,0)); 
-                }
-            }
-
-
-            GdbMiParser::parseVariableData(rootNode, &tokenList);
-
-        }
-        
-    }
-    else
-    {
-        //errorMsg("Unknown token ('%s')", stringToCStr(token->getString()));
-    }
-
-    for(int i = 0;i < orgList.size();i++)
-    {
-        Token *tok = orgList[i];
-        delete tok;
-    }
-    return tree;
+    return varId.startsWith('l');
 }
 
 
 
 Core::Core()
  : m_inf(NULL)
+    ,m_isGroupByObjfile(true)
     ,m_selectedThreadId(0)
     ,m_targetState(ICore::TARGET_STOPPED)
     ,m_lastTargetState(ICore::TARGET_FINISHED)
@@ -102,6 +80,11 @@ Core::Core()
     ,m_isRemote(false)
     ,m_ptsFd(0)
     ,m_scanSources(false)
+    ,m_sourceFilesToken(0)
+    ,m_breakpointFailCount(0)
+    ,m_isBreakpointBatch(false)
+    ,m_targetOutput(TARGET_OUTPUT_BUFFER_SIZE)
+    ,m_targetOutputDecoder(QTextCodec::codecForName("UTF-8"))
 {
     
     Com& com = Com::getInstance();
@@ -114,10 +97,17 @@ Core::Core()
     if(unlockpt(m_ptsFd))
         errorMsg("Failed to unlock pt");
     infoMsg("Using: %s", ptsname(m_ptsFd));
+
+    // Do not block when the output has been drained
+    fcntl(m_ptsFd, F_SETFL, fcntl(m_ptsFd, F_GETFL) | O_NONBLOCK);
     
     m_ptsListener = new QSocketNotifier(m_ptsFd, QSocketNotifier::Read);
     connect(m_ptsListener, SIGNAL(activated(int)), this, SLOT(onGdbOutput(int)));
 
+    m_targetOutputTimer.setSingleShot(true);
+    m_targetOutputTimer.setInterval(TARGET_OUTPUT_INTERVAL);
+    connect(&m_targetOutputTimer, SIGNAL(timeout()), this, SLOT(onTargetOutputTimeout()));
+
 }
 
 Core::~Core()
@@ -254,47 +244,159 @@ int Core::initRemote(Settings *cfg, QString gdbPath, QString programPath, QStrin
 }
 
 
+/**
+ * @brief The target has written to its terminal.
+ *
+ * The output is buffered and passed on to the GUI by onTargetOutputTimeout()
+ * so that a target that writes a lot does not flood the GUI with updates.
+ */
 void Core::onGdbOutput(int socketFd)
 {
     Q_UNUSED(socketFd);
-    char buff[128];
-    int n =  read(m_ptsFd, buff, sizeof(buff)-1);
-    if(n > 0)
+    char buff[TARGET_OUTPUT_READ_SIZE];
+    int totalLen = 0;
+    while(totalLen < TARGET_OUTPUT_MAX_READ)
     {
-        buff[n] = '\0';
+        int n = read(m_ptsFd, buff, sizeof(buff));
+        if(n <= 0)
+            break;
+        m_targetOutput.append(buff, n);
+        totalLen += n;
     }
-    m_inf->ICore_onTargetOutput(buff);
+
+    if(!m_targetOutput.isEmpty() && !m_targetOutputTimer.isActive())
+        m_targetOutputTimer.start();
+}
+
+
+/**
+ * @brief Passes the buffered target output on to the GUI.
+ */
+void Core::onTargetOutputTimeout()
+{
+    if(m_targetOutput.getDroppedCount() > 0)
+    {
+        debugMsg("Dropped %d bytes of target output", m_targetOutput.getDroppedCount());
+
+        // Do not continue a character that was cut in half
+        m_targetOutputDecoder.toUnicode("\n", 1);
+    }
+
+    QByteArray data;
+    data.resize(m_targetOutput.size());
+    m_targetOutput.take(data.data(), data.size());
+    m_targetOutput.clear();
+
+    m_inf->ICore_onTargetOutput(m_targetOutputDecoder.toUnicode(data));
 }
 
 
 /**
  * @brief Reads a memory area.
+ *
+ * The memory is read a page at a time and kept until the target is started again.
+ * @param data    Set to the bytes that could be read (from the start of the area).
  */
 int Core::gdbGetMemory(uint64_t addr, size_t count, QByteArray *data)
 {
-    Com& com = Com::getInstance();
-    Tree resultData;
-
     int rc = 0;
-    QString cmdStr;
-    cmdStr.sprintf("-data-read-memory-bytes 0x%lx %u" , addr, (unsigned int)count);
-    
-    rc = com.command(&resultData, cmdStr);
 
+    data->clear();
+    if(count == 0)
+        return 0;
+
+    uint64_t firstPage = addr / MEMORY_PAGE_SIZE;
+    uint64_t lastPage = (addr+count-1) / MEMORY_PAGE_SIZE;
+
+    // Any page missing? Then read the pages around them as well (Eg: for scrolling).
+    for(uint64_t page = firstPage;page <= lastPage;page++)
+    {
+        if(!m_memoryCache.contains(page))
+        {
+            if(m_memoryCache.size() > MEMORY_CACHE_MAX_PAGES)
+                clearMemoryCache();
+
+            uint64_t readFirstPage = firstPage > MEMORY_READ_AHEAD_PAGES ? firstPage-MEMORY_READ_AHEAD_PAGES : 0;
+            rc = gdbReadMemoryPages(readFirstPage, lastPage+MEMORY_READ_AHEAD_PAGES);
+            break;
+        }
+    }
 
-    QString dataStr = resultData.getString("/memory/1/contents");
-    if(!dataStr.isEmpty())
+    for(uint64_t page = firstPage;page <= lastPage;page++)
     {
-        data->clear();
+        const QByteArray pageData = m_memoryCache.value(page);
+        int from = page == firstPage ? addr % MEMORY_PAGE_SIZE : 0;
+        int to = page == lastPage ? (addr+count-1) % MEMORY_PAGE_SIZE + 1 : MEMORY_PAGE_SIZE;
 
-        QByteArray dataByteArray = dataStr.toLocal8Bit();
-        const char *dataCStr = dataByteArray.constData();
-        int dataCStrLen = strlen(dataCStr);
-        for(int i = 0;i+1 < dataCStrLen;i+=2)
+        if(pageData.size() > from)
+            data->append(pageData.constData()+from, qMin(pageData.size(), to)-from);
+
+        // Stop at the first byte that could not be read
+        if(pageData.size() < to)
+            break;
+    }
+
+    return rc;
+}
+
+
+/**
+ * @brief Reads the pages in a range that are not in the memory cache.
+ *
+ * The pages that can not be read are stored as empty so that they are not asked for again.
+ */
+int Core::gdbReadMemoryPages(uint64_t firstPage, uint64_t lastPage)
+{
+    Com& com = Com::getInstance();
+    int rc = 0;
+
+    uint64_t page = firstPage;
+    while(page <= lastPage)
+    {
+        // Find the next range of missing pages
+        if(m_memoryCache.contains(page))
         {
-            unsigned char dataByte = hexStringToU8(dataCStr+i);
-            
-            data->push_back(dataByte);
+            page++;
+            continue;
+        }
+        uint64_t runFirstPage = page;
+        while(page <= lastPage && !m_memoryCache.contains(page))
+            m_memoryCache[page++] = QByteArray();
+        uint64_t runStart = runFirstPage*MEMORY_PAGE_SIZE;
+        uint64_t runEnd = page*MEMORY_PAGE_SIZE;
+
+        QString cmdStr;
+        cmdStr.sprintf("-data-read-memory-bytes 0x%llx %u" , (unsigned long long)runStart, (unsigned int)(runEnd-runStart));
+        Tree resultData;
+        rc = com.command(&resultData, cmdStr);
+
+        // Only the parts that can be read are returned
+        TreeNode *memoryNode = resultData.findChild(g_pathMemory);
+        for(int i = 0;memoryNode != NULL && i < memoryNode->getChildCount();i++)
+        {
+            TreeNode *blockNode = memoryNode->getChild(i);
+            uint64_t blockStart = blockNode->getString(g_pathBegin).toULongLong(0,0);
+            uint64_t blockEnd = blockNode->getString(g_pathEnd).toULongLong(0,0);
+            QByteArray contents;
+            TreeNode *contentsNode = blockNode->findChild(g_pathContents);
+            if(contentsNode != NULL)
+            {
+                int hexLen;
+                const char *hexStr = contentsNode->getRawData(&hexLen);
+                contents.resize(hexLen/2);
+                contents.resize(hexStringToBytes(hexStr, hexLen, (unsigned char*)contents.data()));
+            }
+            if(blockEnd > blockStart+contents.size())
+                blockEnd = blockStart+contents.size();
+
+            // Store the pages that the block covers from their start
+            uint64_t blockPage = (blockStart+MEMORY_PAGE_SIZE-1) / MEMORY_PAGE_SIZE;
+            for(;blockPage*MEMORY_PAGE_SIZE < blockEnd;blockPage++)
+            {
+                uint64_t pageStart = blockPage*MEMORY_PAGE_SIZE;
+                uint64_t pageEnd = qMin(blockEnd, pageStart+MEMORY_PAGE_SIZE);
+                m_memoryCache[blockPage] = contents.mid(pageStart-blockStart, pageEnd-pageStart);
+            }
         }
     }
 
@@ -302,86 +404,118 @@ int Core::gdbGetMemory(uint64_t addr, size_t count, QByteArray *data)
 }
 
 
+/**
+ * @brief Removes the pages that overlaps a memory area from the memory cache.
+ */
+void Core::invalidateMemory(uint64_t addr, uint64_t len)
+{
+    if(len == 0)
+        return;
+    uint64_t lastPage = (addr+len-1) / MEMORY_PAGE_SIZE;
+    for(uint64_t page = addr / MEMORY_PAGE_SIZE;page <= lastPage;page++)
+        m_memoryCache.remove(page);
+}
+
+
+void Core::clearMemoryCache()
+{
+    m_memoryCache.clear();
+}
+
+
 /**
 * @brief Asks GDB for a list of source files.
-* @return true if any files was added or removed.
+*
+* The list is received in the background and the files that are new are
+* reported with ICore_onSourceFileListChanged().
 */
-bool Core::gdbGetFiles()
+void Core::gdbGetFiles()
 {
     Com& com = Com::getInstance();
-    Tree resultData;
-    QMap<QString, bool> fileLookup;
-    bool modified = false;
-    
-    com.command(&resultData, "-file-list-exec-source-files");
 
+    // Already asked?
+    if(m_sourceFilesToken != 0)
+        return;
 
-    // Clear the old list
-    for(int m = 0;m < m_sourceFiles.size();m++)
-    {
-        SourceFile *sourceFile = m_sourceFiles[m];
-        fileLookup[sourceFile->fullName] = false;
-        delete sourceFile;
-    }
-    m_sourceFiles.clear();
+    if(m_isGroupByObjfile)
+        m_sourceFilesToken = com.commandAsync(this, "-file-list-exec-source-files --group-by-objfile");
+    else
+        m_sourceFilesToken = com.commandAsync(this, "-file-list-exec-source-files");
+}
+
+
+/**
+ * @brief Adds a source file from a '-file-list-exec-source-files' result.
+ * @return The new file or NULL if it was already added (or is not a real file).
+ */
+SourceFile *Core::addSourceFile(TreeNode *fileNode)
+{
+    QString name = fileNode->getString(g_pathFile);
+    QString fullname = fileNode->getString(g_pathFullname);
+
+    if(fullname.isEmpty() || name.contains("<built-in>"))
+        return NULL;
+
+    // Already added this file?
+    if(m_sourceFiles.contains(fullname))
+        return NULL;
 
+    SourceFile *sourceFile = new SourceFile; 
+    sourceFile->name = name;
+    sourceFile->fullName = fullname;
+    m_sourceFiles[fullname] = sourceFile;
+    return sourceFile;
+}
+
+
+/**
+ * @brief Merges a '-file-list-exec-source-files' result into the list of source files.
+ *
+ * If the files are grouped by objfile, the objfiles that has already been
+ * scanned are skipped.
+ * @return The files that was added.
+ */
+QList<SourceFile*> Core::updateSourceFiles(Tree &resultData)
+{
+    QList<SourceFile*> addedFiles;
 
-    // Create the new list
     for(int k = 0;k < resultData.getRootChildCount();k++)
     {
         TreeNode *rootNode = resultData.getChildAt(k);
-        QString rootName = rootNode->getName();
+        if(rootNode->getNameAtom() != ATOM_FILES)
+            continue;
 
-        if(rootName == "files")
+        for(TreeNode *fileNode = rootNode->getFirstChild();fileNode != NULL;fileNode = fileNode->getNextSibling())
         {
-            QStringList childList = resultData.getChildList("files");
-            for(int j = 0;j < childList.size();j++)
-            {
-                QString treePath = "files/" + childList[j];
-                QString name = resultData.getString(treePath + "/file");
-                QString fullname = resultData.getString(treePath + "/fullname");
+            TreeNode *sourcesNode = fileNode->findChild(g_pathSources);
 
-                if(fullname.isEmpty())
-                    continue;
+            // Not grouped by objfile?
+            if(sourcesNode == NULL)
+            {
+                SourceFile *sourceFile = addSourceFile(fileNode);
+                if(sourceFile)
+                    addedFiles.append(sourceFile);
+                continue;
+            }
 
-                SourceFile *sourceFile = NULL;
-                if(!name.contains("<built-in>"))
-                {
-                    // Already added this file?
-                    bool alreadyAdded = false;
-                    if(fileLookup.contains(fullname))
-                    {
-                        if(fileLookup[fullname] == true)
-                            alreadyAdded = true;
-                    }
-                    else
-                        modified = true;
-                        
-                    if(!alreadyAdded)
-                    {
-                        fileLookup[fullname] = true;
-                        
-                        sourceFile = new SourceFile; 
+            QString objfile = fileNode->getString(g_pathFilename);
+            if(m_scannedObjfiles.contains(objfile))
+                continue;
 
-                        sourceFile->name = name;
-                        sourceFile->fullName = fullname;
+            // GDB may not have read all the debug info of the objfile yet
+            if(fileNode->getString(g_pathDebugInfo) == "fully-read")
+                m_scannedObjfiles.insert(objfile);
 
-                        m_sourceFiles.append(sourceFile);
-                    }
-                }
+            for(TreeNode *sourceNode = sourcesNode->getFirstChild();sourceNode != NULL;sourceNode = sourceNode->getNextSibling())
+            {
+                SourceFile *sourceFile = addSourceFile(sourceNode);
+                if(sourceFile)
+                    addedFiles.append(sourceFile);
             }
         }
     }
 
-    // Any file removed?
-    QMap<QString, bool> ::const_iterator iterFl = fileLookup.constBegin();
-    while (iterFl != fileLookup.constEnd()) {
-        if(iterFl.value() == false)
-            modified = false;
-        ++iterFl;
-    }
-    
-    return modified;
+    return addedFiles;
 }
 
 
@@ -499,16 +633,6 @@ void Core::gdbNext()
 }
 
 
-void Core::getStackFrames()
-{
-    Com& com = Com::getInstance();
-    Tree resultData;
-    com.command(&resultData, "-stack-list-frames");
-
-}
-
-
-
 void Core::gdbStepIn()
 {
     Com& com = Com::getInstance();
@@ -523,7 +647,6 @@ void Core::gdbStepIn()
 
         
     com.commandF(&resultData, "-exec-step");
-    com.commandF(&resultData, "-var-update --all-values *");
 
 }
 
@@ -542,7 +665,6 @@ void Core::gdbStepOut()
 
         
     com.commandF(&resultData, "-exec-finish");
-    com.commandF(&resultData, "-var-update --all-values *");
 
 }
 
@@ -598,7 +720,13 @@ int Core::gdbAddVarWatch(QString varName, QString *varType, QString *value, QStr
 }
 
 
-void Core::gdbExpandVarWatchChildren(QString watchId)
+/**
+ * @brief Gets the children of a watch.
+ * @param from     Index of the first child to get.
+ * @param count    Number of children to get (or -1 for all of them).
+ * @return True if there are more children after the ones that was received.
+ */
+bool Core::gdbExpandVarWatchChildren(QString watchId, int from, int count)
 {
     int res;
     Tree resultData;
@@ -608,32 +736,38 @@ void Core::gdbExpandVarWatchChildren(QString watchId)
 //    QString varName = m_watchList[watchId].name;
 
     // Request its children
-    res = com.commandF(&resultData, "-var-list-children --all-values %s", stringToCStr(watchId));
+    if(count < 0)
+        res = com.commandF(&resultData, "-var-list-children --all-values %s", stringToCStr(watchId));
+    else
+        res = com.commandF(&resultData, "-var-list-children --all-values %s %d %d", stringToCStr(watchId), from, from+count);
 
     if(res != 0)
     {
-        return;
+        return false;
     }
 
         
     // Enumerate the children
-    QStringList childList = resultData.getChildList("children");
-    for(int i = 0;i < childList.size();i++)
+    TreeNode *childrenNode = resultData.getRoot()->findChild("children");
+    TreeNode *childNode = childrenNode ? childrenNode->getFirstChild() : NULL;
+    for(;childNode != NULL;childNode = childNode->getNextSibling())
     {
         // Get name and value
-        QString treePath;
-        treePath.sprintf("children/#%d",i+1);
-        QString childName = resultData.getString(treePath + "/name");
-        QString childExp = resultData.getString(treePath + "/exp");
-        QString childValue = resultData.getString(treePath + "/value");
-        QString childType = resultData.getString(treePath + "/type");
-        int numChild = resultData.getInt(treePath + "/numchild", 0);
+        QString childName = childNode->getString(g_pathName);
+        QString childExp = childNode->getString(g_pathExp);
+        QString childValue = childNode->getString(g_pathValue);
+        QString childType = childNode->getString(g_pathType);
+        int numChild = childNode->getInt(g_pathNumChild, 0);
         bool hasChildren = false;
         if(numChild > 0)
             hasChildren = true;
-        m_inf->ICore_onWatchVarChildAdded(childName, childExp, childValue, childType, hasChildren);
+        if(isLocalVarId(childName))
+            m_inf->ICore_onLocalVarChanged(childName, childExp, childValue, childType, hasChildren);
+        else
+            m_inf->ICore_onWatchVarChildAdded(childName, childExp, childValue, childType, hasChildren);
     }
-    
+
+    return resultData.getInt(g_pathHasMore, 0) != 0;
 }
 
 
@@ -676,49 +810,73 @@ void Core::onNotifyAsyncOut(Tree &tree, AsyncClass ac)
 {
     debugMsg("NotifyAsyncOut> %s", Com::asyncClassToString(ac));
 
-     if(ac == ComListener::AC_BREAKPOINT_MODIFIED)
+     if(ac == ComListener::AC_BREAKPOINT_MODIFIED || ac == ComListener::AC_BREAKPOINT_CREATED)
     {
 
         for(int i = 0;i < tree.getRootChildCount();i++)
         {
             TreeNode *rootNode = tree.getChildAt(i);
-            QString rootName = rootNode->getName();
-
-            if(rootName == "bkpt")
+            if(rootNode->getNameAtom() == ATOM_BKPT)
             {
                 dispatchBreakpointTree(tree);
             }
         }
     }
+    // A breakpoint was deleted (Eg: with the 'delete' command in the console)
+    else if(ac == ComListener::AC_BREAKPOINT_DELETED)
+    {
+        removeBreakPoint(tree.getInt("id"));
+    }
     // A new thread has been created
     else if(ac == ComListener::AC_THREAD_CREATED)
     {
-        gdbGetThreadList();
-        
+        // The rest of the information is received with -thread-info the next time the target stops
+        ThreadInfo tinfo;
+        tinfo.id = tree.getInt("id");
+        tinfo.m_name.sprintf("Thread %d", tinfo.id);
+        m_threadList[tinfo.id] = tinfo;
+
+        if(m_inf)
+            m_inf->ICore_onThreadListChanged(QList<ThreadInfo>() << tinfo, QList<int>());
+    }
+    else if(ac == ComListener::AC_THREAD_EXITED)
+    {
+        int threadId = tree.getInt("id");
+        if(m_threadList.remove(threadId) && m_inf)
+            m_inf->ICore_onThreadListChanged(QList<ThreadInfo>(), QList<int>() << threadId);
     }
     else if(ac == ComListener::AC_LIBRARY_LOADED)
     {
         m_scanSources = true;
     }
+    // Scan the library again if it is loaded again
+    else if(ac == ComListener::AC_LIBRARY_UNLOADED)
+    {
+        m_scannedObjfiles.remove(tree.getString("host-name"));
+    }
+    // The memory was written to (Eg: by assigning a variable)
+    else if(ac == ComListener::AC_MEMORY_CHANGED)
+    {
+        invalidateMemory(tree.getString(g_pathAddr).toULongLong(0,0), tree.getString(g_pathLen).toULongLong(0,0));
+    }
     tree.dump();
 }
 
-ICore::StopReason Core::parseReasonString(QString reasonString)
+ICore::StopReason Core::parseReason(const TreeNode *reasonNode)
 {
-    if( reasonString == "breakpoint-hit")
-        return ICore::BREAKPOINT_HIT;
-    if(reasonString == "end-stepping-range")
-        return ICore::END_STEPPING_RANGE;
-    if(reasonString == "signal-received" || reasonString == "exited-signalled")
-        return ICore::SIGNAL_RECEIVED;
-    if(reasonString == "exited-normally")
-        return ICore::EXITED_NORMALLY;
-    if(reasonString == "function-finished")
-        return ICore::FUNCTION_FINISHED;
-    if(reasonString == "exited")
-        return ICore::EXITED;
+    switch(reasonNode->getDataAtom())
+    {
+        case ATOM_BREAKPOINT_HIT: return ICore::BREAKPOINT_HIT;
+        case ATOM_END_STEPPING_RANGE: return ICore::END_STEPPING_RANGE;
+        case ATOM_SIGNAL_RECEIVED:
+        case ATOM_EXITED_SIGNALLED: return ICore::SIGNAL_RECEIVED;
+        case ATOM_EXITED_NORMALLY: return ICore::EXITED_NORMALLY;
+        case ATOM_FUNCTION_FINISHED: return ICore::FUNCTION_FINISHED;
+        case ATOM_EXITED: return ICore::EXITED;
+        default:;break;
+    }
     
-    errorMsg("Received unknown reason (\"%s\").", stringToCStr(reasonString));
+    errorMsg("Received unknown reason (\"%s\").", stringToCStr(reasonNode->getData()));
     assert(0);
 
     return ICore::UNKNOWN;
@@ -737,34 +895,46 @@ void Core::onExecAsyncOut(Tree &tree, AsyncClass ac)
     {
         m_targetState = ICore::TARGET_STOPPED;
 
+        // Memory read while the target was running may be out of date
+        clearMemoryCache();
+
+        m_currentFrameIdx = tree.getInt("frame/level");
+        m_selectedThreadId = tree.getInt("thread-id");
+        storeFrameInfo(tree);
+
+        // Request the new state of the target all at once and wait for
+        // the whole batch before the results are dispatched.
         if(m_pid == 0)
-            com.command(NULL, "-list-thread-groups");
+            com.commandAsync(NULL, "-list-thread-groups");
+
+        // The frames that was selected during the last stop are gone
+        for(int i = 0;i < m_staleVarIds.size();i++)
+            com.commandAsyncF(NULL, "-var-delete %s", stringToCStr(m_staleVarIds[i]));
+        m_staleVarIds.clear();
          
         // Any new or destroyed thread?
-        com.commandF(NULL, "-thread-info");
+        com.commandAsync(NULL, "-thread-info");
 
-        com.commandF(NULL, "-var-update --all-values *");
-        com.commandF(NULL, "-stack-list-locals 1");
+        // Only the variables that has changed are reported
+        com.commandAsync(NULL, "-var-update --all-values *");
+        m_frameLocalNames.clear();
+        com.commandAsync(NULL, "-stack-list-locals 0");
+        com.commandAsync(NULL, "-stack-list-frames");
 
-        if(m_scanSources)
-        {
-            if(gdbGetFiles())
-            {
-                m_inf->ICore_onSourceFileListChanged();
-            }
-            m_scanSources = false;
-        }    
+        com.waitForCommands();
+
+        updateLocalVars();
 
         QString p = tree.getString("frame/fullname");
         int lineNo = tree.getInt("frame/line");
 
         // Get the reason
-        QString reasonString = tree.getString("reason");
+        TreeNode *reasonNode = tree.findChild(g_pathReason);
         ICore::StopReason  reason;
-        if(reasonString.isEmpty())
+        if(reasonNode == NULL || reasonNode->getData().isEmpty())
             reason = ICore::UNKNOWN;
         else
-            reason = parseReasonString(reasonString);
+            reason = parseReason(reasonNode);
 
         if(reason == ICore::EXITED_NORMALLY)
         {
@@ -786,20 +956,10 @@ void Core::onExecAsyncOut(Tree &tree, AsyncClass ac)
                 m_inf->ICore_onStopped(reason, p, lineNo);
 
             m_inf->ICore_onFrameVarReset();
+            for(int i = 0;i < m_frame.argNames.size();i++)
+                m_inf->ICore_onFrameVarChanged(m_frame.argNames[i], m_frame.argValues[i]);
 
-            QStringList childList = tree.getChildList("frame/args");
-            for(int i = 0;i < childList.size();i++)
-            {
-                QString treePath = "frame/args/" + childList[i];
-                QString varName = tree.getString(treePath + "/name");
-                QString varValue = tree.getString(treePath + "/value");
-                if(m_inf)
-                    m_inf->ICore_onFrameVarChanged(varName, varValue);
-            }
-
-            int frameIdx = tree.getInt("frame/level");
-            m_currentFrameIdx = frameIdx;
-            m_inf->ICore_onCurrentFrameChanged(frameIdx);
+            m_inf->ICore_onCurrentFrameChanged(m_currentFrameIdx);
 
         }
     }
@@ -807,6 +967,9 @@ void Core::onExecAsyncOut(Tree &tree, AsyncClass ac)
     {
         m_targetState = ICore::TARGET_RUNNING;
 
+        clearFrameCache();
+        clearMemoryCache();
+
         debugMsg("is running");
     }
 
@@ -822,10 +985,22 @@ void Core::onExecAsyncOut(Tree &tree, AsyncClass ac)
     // State changed?
     if(m_inf && m_lastTargetState != m_targetState)
     {
+        // The variable objects of the locals are recreated the next time the target stops
+        if(m_targetState == ICore::TARGET_FINISHED)
+            m_frame.localVarsFrame.clear();
+
         m_inf->ICore_onStateChanged(m_targetState);
         m_lastTargetState = m_targetState;
     
     }
+
+    // Get the files of the libraries that has been loaded (in the
+    // background, after everything else about the stop has been shown).
+    if(ac == ComListener::AC_STOPPED && m_scanSources)
+    {
+        m_scanSources = false;
+        gdbGetFiles();
+    }
 }
 
 
@@ -838,12 +1013,71 @@ void Core::gdbRemoveBreakpoint(BreakPoint* bkpt)
     
     com.commandF(&resultData, "-break-delete %d", bkpt->m_number);    
 
-    m_breakpoints.removeOne(bkpt);
+    removeBreakPoint(bkpt->m_number);
+}
 
-    if(m_inf)
-        m_inf->ICore_onBreakpointsChanged();
+
+/**
+ * @brief Removes a breakpoint that has been deleted in GDB.
+ */
+void Core::removeBreakPoint(int number)
+{
+    BreakPoint *bkpt = m_breakpoints.take(number);
+    if(bkpt == NULL)
+        return;
+
+    unindexBreakPoint(bkpt);
+
+    addBreakPointChange(bkpt, true);
     delete bkpt;
-    
+
+    notifyBreakPointChanges();
+}
+
+
+/**
+ * @brief Removes a breakpoint from the file and line index.
+ */
+void Core::unindexBreakPoint(BreakPoint *bkpt)
+{
+    QMultiMap<int, BreakPoint*> &lineMap = m_fileBreakpoints[bkpt->fullname];
+    lineMap.remove(bkpt->lineNo, bkpt);
+    if(lineMap.isEmpty())
+        m_fileBreakpoints.remove(bkpt->fullname);
+}
+
+
+/**
+ * @brief Records that a breakpoint is about to be changed.
+ *
+ * Must be called before the breakpoint is moved (so that its old
+ * position can be reported).
+ */
+void Core::addBreakPointChange(BreakPoint *bkpt, bool isRemoved)
+{
+    BreakPointChange change;
+    change.number = bkpt->m_number;
+    change.oldFullname = bkpt->fullname;
+    change.oldLineNo = bkpt->lineNo;
+    change.isRemoved = isRemoved;
+    m_breakpointChanges.append(change);
+}
+
+
+/**
+ * @brief Tells the listener about the recorded breakpoint changes.
+ *
+ * The changes are held back while a batch of breakpoints is being set.
+ */
+void Core::notifyBreakPointChanges()
+{
+    if(m_isBreakpointBatch || m_breakpointChanges.isEmpty())
+        return;
+
+    QList<BreakPointChange> changes = m_breakpointChanges;
+    m_breakpointChanges.clear();
+    if(m_inf)
+        m_inf->ICore_onBreakpointsChanged(changes);
 }
 
 void Core::gdbEnableBreakpoint(BreakPoint *bkpt, bool enabled)
@@ -859,59 +1093,31 @@ void Core::gdbEnableBreakpoint(BreakPoint *bkpt, bool enabled)
         com.commandF(&resultData, "-break-disable %d", bkpt->m_number);
     }
 
-    if(m_inf)
-        m_inf->ICore_onBreakpointsChanged();
+    addBreakPointChange(bkpt, false);
+    notifyBreakPointChanges();
 }
 
-void Core::gdbGetThreadList()
+BreakPoint* Core::findBreakPoint(QString fullPath, int lineNo)
 {
-    Com& com = Com::getInstance();
-    Tree resultData;
-
-    if(m_targetState == ICore::TARGET_RUNNING)
-    {
-        if(m_inf)
-            m_inf->ICore_onMessage("Program is currently running");
-        return;
-    }
-
-    
-    com.commandF(&resultData, "-thread-info");    
-
-
+    QHash<QString, QMultiMap<int, BreakPoint*> >::const_iterator fileItr = m_fileBreakpoints.find(fullPath);
+    if(fileItr == m_fileBreakpoints.constEnd())
+        return NULL;
+    return fileItr.value().value(lineNo, NULL);
 }
 
 
-BreakPoint* Core::findBreakPoint(QString fullPath, int lineNo)
+BreakPoint* Core::findBreakPointByNumber(int number)
 {
-    for(int i = 0;i < m_breakpoints.size();i++)
-    {
-        BreakPoint *bkpt = m_breakpoints[i];
-
-    
-        if(bkpt->lineNo == lineNo && fullPath == bkpt->fullname)
-        {
-            return bkpt;
-        }
-    }
-
-    return NULL;
+    return m_breakpoints.value(number, NULL);
 }
 
 
-BreakPoint* Core::findBreakPointByNumber(int number)
+/**
+ * @brief Returns the lines in a file that has breakpoints (in ascending order).
+ */
+QList<int> Core::getBreakPointLines(QString fullPath)
 {
-    for(int i = 0;i < m_breakpoints.size();i++)
-    {
-        BreakPoint *bkpt = m_breakpoints[i];
-
-    
-        if(bkpt->m_number == number)
-        {
-            return bkpt;
-        }
-    }
-    return NULL;
+    return m_fileBreakpoints.value(fullPath).uniqueKeys();
 }
 
 
@@ -921,22 +1127,34 @@ void Core::dispatchBreakpointTree(Tree &tree)
     int number = tree.getInt("bkpt/number");
                 
 
+    QString fullname = tree.getString("bkpt/fullname");
+
     BreakPoint *bkpt = findBreakPointByNumber(number);
+    bool isIndexed = true;
     if(bkpt == NULL)
     {
         bkpt = new BreakPoint(number);
-        m_breakpoints.push_back(bkpt);
+        bkpt->lineNo = 0;
+        m_breakpoints[number] = bkpt;
+        isIndexed = false;
+    }
+    addBreakPointChange(bkpt, false);
+
+    // Moved?
+    if(isIndexed && (bkpt->lineNo != lineNo || bkpt->fullname != fullname))
+    {
+        unindexBreakPoint(bkpt);
+        isIndexed = false;
     }
+    if(!isIndexed)
+        m_fileBreakpoints[fullname].insert(lineNo, bkpt);
     bkpt->lineNo = lineNo;
-    bkpt->fullname = tree.getString("bkpt/fullname");
+    bkpt->fullname = fullname;
     bkpt->m_funcName = tree.getString("bkpt/func");
     bkpt->m_addr = tree.getLongLong("bkpt/addr");
     bkpt->enabled = (tree.getString("bkpt/enabled") == "y");
-    if(m_inf)
-        m_inf->ICore_onBreakpointsChanged();
 
-
-    
+    notifyBreakPointChanges();
 }
         
 void Core::onResult(Tree &tree)
@@ -948,45 +1166,62 @@ void Core::onResult(Tree &tree)
     for(int i = 0;i < tree.getRootChildCount();i++)
     {
         TreeNode *rootNode = tree.getChildAt(i);
-        QString rootName = rootNode->getName();
-        if(rootName == "changelist")
+        Atom rootAtom = rootNode->getNameAtom();
+        if(rootAtom == ATOM_CHANGELIST)
          {
             debugMsg("Changelist");
-            for(int j = 0;j < rootNode->getChildCount();j++)
+            for(TreeNode *changeNode = rootNode->getFirstChild();changeNode != NULL;changeNode = changeNode->getNextSibling())
             {
-                QString path;
-                path.sprintf("changelist/%d/name", j+1);
-                QString watchId = tree.getString(path);
-                path.sprintf("changelist/%d/value", j+1);
-                QString varValue = tree.getString(path);
+                QString watchId = changeNode->getString(g_pathName);
+                QString varValue = changeNode->getString(g_pathValue);
 
-                QString varName = gdbGetVarWatchName(watchId);
-                    
                 bool hasChildren = false;
                 if (varValue == "{...}")
                     hasChildren = true;
+
+                // A local variable?
+                if(isLocalVarId(watchId))
+                {
+                    // The frame that it was created in is gone?
+                    if(changeNode->getString(g_pathInScope) != "true")
+                        m_frame.localVarsFrame.clear();
+                    else
+                    {
+                        for(int j = 0;j < m_frame.locals.size();j++)
+                        {
+                            if(m_frame.locals[j].varId == watchId)
+                                m_frame.locals[j].value = varValue;
+                        }
+                        if(m_inf)
+                            m_inf->ICore_onLocalVarChanged(watchId, "", varValue, "", hasChildren);
+                    }
+                    continue;
+                }
+
+                QString varName = gdbGetVarWatchName(watchId);
+                    
                 if(m_inf)
                     m_inf->ICore_onWatchVarChanged(watchId, varName, varValue, hasChildren);
             }
             
         }
-        else if(rootName == "bkpt")
+        else if(rootAtom == ATOM_BKPT)
         {
             dispatchBreakpointTree(tree);
                 
         }
-        else if(rootName == "threads")
+        else if(rootAtom == ATOM_THREADS)
         {
+            QMap <int, ThreadInfo> oldThreadList = m_threadList;
+            QList<ThreadInfo> changedThreads;
             m_threadList.clear();
             
             // Parse the result
-            QStringList childList = tree.getChildList("threads");
-            for(int i = 0;i < childList.size();i++)
+            for(TreeNode *threadNode = rootNode->getFirstChild();threadNode != NULL;threadNode = threadNode->getNextSibling())
             {
-                QString treePath = "threads/" + childList[i];
-                QString threadId = tree.getString(treePath + "/id");
-                QString targetId = tree.getString(treePath + "/target-id");
-                QString funcName = tree.getString(treePath + "/frame/func");
+                QString threadId = threadNode->getString(g_pathId);
+                QString targetId = threadNode->getString(g_pathTargetId);
+                QString funcName = threadNode->getString(g_pathFrameFunc);
 
                 
                 ThreadInfo tinfo;
@@ -994,13 +1229,25 @@ void Core::onResult(Tree &tree)
                 tinfo.m_name = targetId;
                 tinfo.m_func = funcName;
                 m_threadList[tinfo.id] = tinfo;
+
+                // New or changed?
+                bool isChanged = true;
+                if(oldThreadList.contains(tinfo.id))
+                {
+                    ThreadInfo oldInfo = oldThreadList.take(tinfo.id);
+                    isChanged = (oldInfo.m_name != tinfo.m_name || oldInfo.m_func != tinfo.m_func);
+                }
+                if(isChanged)
+                    changedThreads.append(tinfo);
             }
 
-            if(m_inf)
-                m_inf->ICore_onThreadListChanged();
+            // Only tell about the differences (the threads that are left has exited)
+            QList<int> removedThreadIds = oldThreadList.keys();
+            if(m_inf && (!changedThreads.isEmpty() || !removedThreadIds.isEmpty()))
+                m_inf->ICore_onThreadListChanged(changedThreads, removedThreadIds);
             
         }
-        else if(rootName == "current-thread-id")
+        else if(rootAtom == ATOM_CURRENT_THREAD_ID)
         {
             // Get the current thread
             QString threadIdStr = tree.getString("current-thread-id");
@@ -1011,7 +1258,7 @@ void Core::onResult(Tree &tree)
                     m_inf->ICore_onCurrentThreadChanged(threadId);
             }
         }
-        else if(rootName == "frame")
+        else if(rootAtom == ATOM_FRAME)
         {
             QString p = tree.getString("frame/fullname");
             int lineNo = tree.getInt("frame/line");
@@ -1019,6 +1266,7 @@ void Core::onResult(Tree &tree)
             ICore::StopReason  reason = ICore::UNKNOWN;
              
             m_currentFrameIdx = frameIdx;
+            storeFrameInfo(tree);
 
             if(m_inf)
             {
@@ -1026,75 +1274,44 @@ void Core::onResult(Tree &tree)
                 m_inf->ICore_onStopped(reason, p, lineNo);
 
                 m_inf->ICore_onFrameVarReset();
-
-                QStringList childList = tree.getChildList("frame/args");
-                for(int i = 0;i < childList.size();i++)
-                {
-                    QString treePath = "frame/args/" + childList[i];
-                    QString varName = tree.getString(treePath + "/name");
-                    QString varValue = tree.getString(treePath + "/value");
-                    if(m_inf)
-                        m_inf->ICore_onFrameVarChanged(varName, varValue);
-                }
+                for(int i = 0;i < m_frame.argNames.size();i++)
+                    m_inf->ICore_onFrameVarChanged(m_frame.argNames[i], m_frame.argValues[i]);
             }
         }
         // A stack frame dump?
-        else if(rootName == "stack")
+        else if(rootAtom == ATOM_STACK)
         {
-            int cnt = tree.getChildCount("stack");
-            QList<StackFrameEntry> stackFrameList;
-            for(int j = 0;j < cnt;j++)
+            m_stackFrames.clear();
+            for(TreeNode *frameNode = rootNode->getFirstChild();frameNode != NULL;frameNode = frameNode->getNextSibling())
             {
-                QString path;
-                path.sprintf("stack/#%d/func", j+1);
-                
-
                 StackFrameEntry entry;
-                path.sprintf("stack/#%d/func", j+1);
-                entry.m_functionName = tree.getString(path);
-                path.sprintf("stack/#%d/line", j+1);
-                entry.m_line = tree.getInt(path);
-                path.sprintf("stack/#%d/fullname", j+1);
-                entry.m_sourcePath = tree.getString(path);
-                stackFrameList.push_front(entry);
-            }
-            if(m_inf)
-            {
-                m_inf->ICore_onStackFrameChange(stackFrameList);
-                m_inf->ICore_onCurrentFrameChanged(m_currentFrameIdx);
+                entry.m_functionName = frameNode->getString(g_pathFunc);
+                entry.m_line = frameNode->getInt(g_pathLine);
+                entry.m_sourcePath = frameNode->getString(g_pathFullname);
+                m_stackFrames.append(entry);
             }
+            dispatchStackFrames();
         }
-        // Local variables?
-        else if(rootName == "locals")
+        // Local variables? (Eg: 'locals=[name="a",name="b"]')
+        else if(rootAtom == ATOM_LOCALS)
         {
-            if(m_inf)
+            m_frameLocalNames.clear();
+            for(TreeNode *localNode = rootNode->getFirstChild();localNode != NULL;localNode = localNode->getNextSibling())
             {
-                m_inf->ICore_onLocalVarReset();
-                
-
-                int cnt = tree.getChildCount("locals");
-                for(int j = 0;j < cnt;j++)
-                {
-                    QString path;
-                    path.sprintf("locals/%d/name", j+1);
-                    QString varName = tree.getString(path);
-                    path.sprintf("locals/%d/value", j+1);
-                    QString varData = tree.getString(path);
-
-                    CoreVarValue val(varData);
-                    m_inf->ICore_onLocalVarChanged(varName, val);
-                    
-                }
+                if(localNode->getNameAtom() == ATOM_NAME)
+                    m_frameLocalNames.append(localNode->getData());
+                else
+                    m_frameLocalNames.append(localNode->getString(g_pathName));
             }
         }
-        else if(rootName == "msg")
+        else if(rootAtom == ATOM_MSG)
         {
             QString message = tree.getString("msg");
             if(m_inf)
                 m_inf->ICore_onMessage(message);
                 
         }
-        else if(rootName == "groups")
+        else if(rootAtom == ATOM_GROUPS)
         {
             if(m_pid == 0)
             {
@@ -1107,6 +1324,104 @@ void Core::onResult(Tree &tree)
     tree.dump();
 }
 
+
+void Core::onCommandResult(int token, GdbResult result, Tree &tree)
+{
+    // Source filelist received?
+    if(token == m_sourceFilesToken)
+    {
+        m_sourceFilesToken = 0;
+        if(result == GDB_ERROR && m_isGroupByObjfile)
+        {
+            // Ask again without grouping the files
+            m_isGroupByObjfile = false;
+            gdbGetFiles();
+        }
+        else if(result == GDB_DONE)
+        {
+            QList<SourceFile*> addedFiles = updateSourceFiles(tree);
+            if(m_inf && !addedFiles.isEmpty())
+                m_inf->ICore_onSourceFileListChanged(addedFiles);
+        }
+    }
+    // A breakpoint of gdbSetBreakpoints() has been set?
+    else if(m_breakpointTokens.remove(token))
+    {
+        if(result == GDB_ERROR)
+            m_breakpointFailCount++;
+    }
+    // The variable object of a local has been created?
+    else if(m_localVarTokens.contains(token))
+    {
+        QString varName = m_localVarTokens.take(token);
+        if(result == GDB_DONE)
+        {
+            LocalVar var;
+            var.varId = tree.getString(g_pathName);
+            var.name = varName;
+            var.value = tree.getString(g_pathValue);
+            var.varType = tree.getString(g_pathType);
+            var.hasChildren = tree.getInt(g_pathNumChild, 0) > 0;
+            m_frame.locals.append(var);
+
+            if(m_inf)
+                m_inf->ICore_onLocalVarChanged(var.varId, var.name, var.value, var.varType, var.hasChildren);
+        }
+    }
+}
+
+
+/**
+ * @brief Creates the variable objects of the locals in the selected frame.
+ *
+ * The variable objects are kept as long as the same frame is selected, so
+ * that "-var-update" only has to report the locals that has changed.
+ */
+void Core::updateLocalVars()
+{
+    Com& com = Com::getInstance();
+
+    // Identify the frame by its thread, its function and its depth (so that
+    // a recursive call does not get the variables of its caller).
+    QString frameKey;
+    if(0 <= m_currentFrameIdx && m_currentFrameIdx < m_stackFrames.size())
+    {
+        frameKey.sprintf("%d:%s:%d", m_selectedThreadId,
+                    stringToCStr(m_stackFrames[m_currentFrameIdx].m_functionName),
+                    m_stackFrames.size()-m_currentFrameIdx);
+    }
+
+    // Same locals as before?
+    if(!frameKey.isEmpty() && frameKey == m_frame.localVarsFrame && m_frameLocalNames == m_frame.localNames)
+        return;
+
+    // Remove the variable objects of the previous frame
+    for(int i = 0;i < m_frame.locals.size();i++)
+        com.commandAsyncF(NULL, "-var-delete %s", stringToCStr(m_frame.locals[i].varId));
+    m_frame.locals.clear();
+
+    if(m_inf)
+        m_inf->ICore_onLocalVarReset();
+
+    // Create new ones (the locals are shown in the reverse order)
+    for(int i = m_frameLocalNames.size()-1;i >= 0;i--)
+    {
+        QString varName = m_frameLocalNames[i];
+        QString varId;
+        varId.sprintf("l%d", m_varWatchLastId++);
+
+        int token = com.commandAsyncF(this, "-var-create %s * %s", stringToCStr(varId), stringToCStr(varName));
+        m_localVarTokens[token] = varName;
+    }
+    com.waitForCommands();
+
+    m_frame.localVarsFrame = frameKey;
+    m_frame.localNames = m_frameLocalNames;
+
+    if(m_inf)
+        m_inf->ICore_onLocalVarListDone();
+}
+
 void Core::onStatusAsyncOut(Tree &tree, AsyncClass ac)
 {
     infoMsg("StatusAsyncOut> %s", Com::asyncClassToString(ac));
@@ -1162,51 +1477,221 @@ int Core::gdbSetBreakpoint(QString filename, int lineNo)
     return rc;
 }
 
+/**
+ * @brief Sets several breakpoints at once (Eg: the ones saved from the last session).
+ *
+ * All the -break-insert commands are sent before the results are waited
+ * for and ICore_onBreakpointsChanged() is only called once.
+ * @return Number of breakpoints that could not be set.
+ */
+int Core::gdbSetBreakpoints(QList<SettingsBreakpoint> bkptList)
+{
+    Com& com = Com::getInstance();
+
+    m_breakpointFailCount = 0;
+    for(int i = 0;i < bkptList.size();i++)
+    {
+        const SettingsBreakpoint &bkptCfg = bkptList[i];
+        assert(bkptCfg.filename != "");
+
+        int token = com.commandAsyncF(this, "-break-insert %s:%d", stringToCStr(bkptCfg.filename), bkptCfg.lineNo);
+        m_breakpointTokens.insert(token);
+    }
+
+    m_isBreakpointBatch = true;
+    com.waitForCommands();
+    m_isBreakpointBatch = false;
+
+    notifyBreakPointChanges();
+
+    return m_breakpointFailCount;
+}
+
+
 QList<ThreadInfo> Core::getThreadList()
 {
     return m_threadList.values();
 }
 
+/**
+ * @brief Selects a specific thread.
+ *
+ * The stack and the frame of a thread that has already been selected
+ * since the target stopped are taken from the cache.
+ */
 void Core::selectThread(int threadId)
 {
     if(m_selectedThreadId == threadId)
         return;
 
     Com& com = Com::getInstance();
-    Tree resultData;
-    
-    
-    com.commandF(&resultData, "-thread-select %d", threadId);
 
-        
+    // Keep what has been received about the current thread
+    m_frameCache[qMakePair(m_selectedThreadId, m_currentFrameIdx)] = m_frame;
+    m_frame = FrameSnapshot();
+    m_stackCache[m_selectedThreadId] = m_stackFrames;
+
     m_selectedThreadId = threadId;
+    bool isStackCached = m_stackCache.contains(threadId);
+
+    // The result of -thread-select tells which frame that is selected (and shows its location)
+    com.commandAsyncF(NULL, "-thread-select %d", threadId);
+    if(!isStackCached)
+        com.commandAsync(NULL, "-stack-list-frames");
+    com.waitForCommands();
+
+    if(isStackCached)
+    {
+        m_stackFrames = m_stackCache.take(threadId);
+        dispatchStackFrames();
+    }
+
+    QPair<int,int> frameId = qMakePair(threadId, m_currentFrameIdx);
+    if(m_frameCache.contains(frameId))
+        restoreFrame(m_frameCache.take(frameId), false);
+    else
+    {
+        m_frameLocalNames.clear();
+        com.commandAsync(NULL, "-stack-list-locals 0");
+        com.waitForCommands();
+
+        updateLocalVars();
+    }
 }
 
 
 /**
  * @brief Selects a specific frame
+ *
+ * A frame that has already been selected since the target stopped is
+ * taken from the cache, so only the -stack-select-frame is sent.
  * @param selectedFrameIdx    The frame to select as active (0=newest frame).
  */
 void Core::selectFrame(int selectedFrameIdx)
 {
     
     Com& com = Com::getInstance();
-    Tree resultData;
 
     if(m_targetState == ICore::TARGET_RUNNING)
     {
         return;
     }
-    if(m_currentFrameIdx != selectedFrameIdx)
+    if(m_currentFrameIdx == selectedFrameIdx)
+        return;
+
+    // Keep what has been received about the current frame
+    m_frameCache[qMakePair(m_selectedThreadId, m_currentFrameIdx)] = m_frame;
+    m_frame = FrameSnapshot();
+
+    com.commandAsyncF(NULL, "-stack-select-frame %d", selectedFrameIdx);
+
+    QPair<int,int> frameId = qMakePair(m_selectedThreadId, selectedFrameIdx);
+    if(m_frameCache.contains(frameId))
+    {
+        // No need to wait for the result
+        m_currentFrameIdx = selectedFrameIdx;
+        restoreFrame(m_frameCache.take(frameId), true);
+    }
+    else
     {
-        com.commandF(NULL, "-stack-select-frame %d", selectedFrameIdx);
+        com.commandAsync(NULL, "-stack-info-frame");
+        m_frameLocalNames.clear();
+        com.commandAsync(NULL, "-stack-list-locals 0");
+        com.waitForCommands();
+
+        updateLocalVars();
+    }
 
+    if(m_inf)
+        m_inf->ICore_onCurrentFrameChanged(m_currentFrameIdx);
+}
 
-        com.commandF(&resultData, "-stack-info-frame");
 
-        com.commandF(NULL, "-stack-list-locals 1");
+/**
+ * @brief Makes a cached frame the selected one and shows it.
+ * @param showLocation   False if the location and the arguments of the frame has already been shown.
+ */
+void Core::restoreFrame(const FrameSnapshot &frame, bool showLocation)
+{
+    m_frame = frame;
+
+    if(m_inf == NULL)
+        return;
+
+    if(showLocation)
+    {
+        m_inf->ICore_onStopped(ICore::UNKNOWN, m_frame.fullname, m_frame.line);
+
+        m_inf->ICore_onFrameVarReset();
+        for(int i = 0;i < m_frame.argNames.size();i++)
+            m_inf->ICore_onFrameVarChanged(m_frame.argNames[i], m_frame.argValues[i]);
+    }
+
+    m_inf->ICore_onLocalVarReset();
+    for(int i = 0;i < m_frame.locals.size();i++)
+    {
+        const LocalVar &var = m_frame.locals[i];
+        m_inf->ICore_onLocalVarChanged(var.varId, var.name, var.value, var.varType, var.hasChildren);
     }
+    m_inf->ICore_onLocalVarListDone();
+}
+
+
+/**
+ * @brief Forgets the frames and the stacks that has been cached since the target stopped.
+ *
+ * The variable objects of the cached frames are deleted the next time
+ * the target stops.
+ */
+void Core::clearFrameCache()
+{
+    QMap<QPair<int,int>, FrameSnapshot>::const_iterator itr = m_frameCache.constBegin();
+    for(;itr != m_frameCache.constEnd();++itr)
+    {
+        const QList<LocalVar> &locals = itr.value().locals;
+        for(int i = 0;i < locals.size();i++)
+            m_staleVarIds.append(locals[i].varId);
+    }
+    m_frameCache.clear();
+    m_stackCache.clear();
+}
+
+
+/**
+ * @brief Keeps the location and the arguments of the selected frame.
+ */
+void Core::storeFrameInfo(Tree &tree)
+{
+    m_frame.fullname = tree.getString("frame/fullname");
+    m_frame.line = tree.getInt("frame/line");
+    m_frame.argNames.clear();
+    m_frame.argValues.clear();
+
+    TreeNode *argsNode = tree.findChild(g_pathFrameArgs);
+    TreeNode *argNode = argsNode ? argsNode->getFirstChild() : NULL;
+    for(;argNode != NULL;argNode = argNode->getNextSibling())
+    {
+        m_frame.argNames.append(argNode->getString(g_pathName));
+        m_frame.argValues.append(argNode->getString(g_pathValue));
+    }
+}
+
+
+/**
+ * @brief Shows the stack of the selected thread.
+ */
+void Core::dispatchStackFrames()
+{
+    if(m_inf == NULL)
+        return;
+
+    // The outermost frame first
+    QList<StackFrameEntry> stackFrameList;
+    for(int i = 0;i < m_stackFrames.size();i++)
+        stackFrameList.push_front(m_stackFrames[i]);
 
+    m_inf->ICore_onStackFrameChange(stackFrameList);
+    m_inf->ICore_onCurrentFrameChanged(m_currentFrameIdx);
 }
 
 
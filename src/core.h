@@ -11,11 +11,18 @@
 
 #include "com.h"
 #include <QList>
+#include <QHash>
 #include <QMap>
+#include <QPair>
+#include <QSet>
 #include <QSocketNotifier>
 #include <QObject>
+#include <QTimer>
+#include <QTextCodec>
+#include <QTextDecoder>
 
 #include "settings.h"
+#include "ringbuffer.h"
 
 struct ThreadInfo
 {
@@ -64,17 +71,14 @@ private:
 
 
 /**
- * @brief The value of a variable.
+ * @brief A breakpoint that has been added, changed or removed (see ICore_onBreakpointsChanged()).
  */
-class CoreVarValue
+struct BreakPointChange
 {
-public:
-    CoreVarValue(QString str) { m_str = str; };
-
-    QString toString();
-    
-    Tree *toTree();
-    QString m_str;
+    int number;
+    QString oldFullname; //!< The file the breakpoint was in before the change (empty if it is new).
+    int oldLineNo;
+    bool isRemoved;
 };
 
 
@@ -111,20 +115,39 @@ class ICore
     virtual void ICore_onStopped(StopReason reason, QString path, int lineNo) = 0;
     virtual void ICore_onStateChanged(TargetState state) = 0;
     virtual void ICore_onSignalReceived(QString signalName) = 0;
-    virtual void ICore_onLocalVarReset() = 0;
-    virtual void ICore_onLocalVarChanged(QString name, CoreVarValue value) = 0;
+    virtual void ICore_onLocalVarReset() = 0; //!< The variable objects of the locals has been replaced (Eg: another frame was selected).
+
+    /**
+     * @brief Called when a local variable (or a child of one) has been added or changed.
+     * @param varId      The id of the GDB variable object (Eg: "l12" or "l12.a").
+     * @param name       The name of the variable (only set when it is added).
+     * @param value      The new value.
+     */
+    virtual void ICore_onLocalVarChanged(QString varId, QString name, QString value, QString varType, bool hasChildren) = 0;
+    virtual void ICore_onLocalVarListDone() = 0; //!< All the locals since ICore_onLocalVarReset() has been reported.
     virtual void ICore_onFrameVarReset() = 0;
     virtual void ICore_onFrameVarChanged(QString name, QString value) = 0;
     virtual void ICore_onWatchVarChanged(QString watchId, QString name, QString value, bool hasChildren) = 0;
     virtual void ICore_onConsoleStream(QString text) = 0;
-    virtual void ICore_onBreakpointsChanged() = 0;
-    virtual void ICore_onThreadListChanged() = 0;
+
+    /**
+     * @brief Called when breakpoints has been added, changed or removed.
+     * @param changes    One entry for each breakpoint (use Core::findBreakPointByNumber() to get its new state).
+     */
+    virtual void ICore_onBreakpointsChanged(QList<BreakPointChange> changes) = 0;
+
+    /**
+     * @brief Called when threads has been created, changed or has exited.
+     * @param changedThreads     The threads that are new or whose information has changed.
+     * @param removedThreadIds   The threads that has exited.
+     */
+    virtual void ICore_onThreadListChanged(QList<ThreadInfo> changedThreads, QList<int> removedThreadIds) = 0;
     virtual void ICore_onCurrentThreadChanged(int threadId) = 0;
     virtual void ICore_onStackFrameChange(QList<StackFrameEntry> stackFrameList) = 0;
     virtual void ICore_onMessage(QString message) = 0;
     virtual void ICore_onTargetOutput(QString message) = 0;
     virtual void ICore_onCurrentFrameChanged(int frameIdx) = 0;
-    virtual void ICore_onSourceFileListChanged() = 0;
+    virtual void ICore_onSourceFileListChanged(QList<SourceFile*> addedFiles) = 0; //!< Source files has been found (Eg: in a library that was loaded).
 
     /**
      * @brief Called when a new child item has been added for a watched item.
@@ -141,10 +164,40 @@ struct VarWatch
     QString name;
     QString watchId;
 };
+
+
+/**
+ * @brief A local variable of a frame (see Core::updateLocalVars()).
+ */
+struct LocalVar
+{
+    QString varId; //!< The GDB variable object (Eg: "l12").
+    QString name;
+    QString value;
+    QString varType;
+    bool hasChildren;
+};
+
+
+/**
+ * @brief What has been received about a frame since the target stopped.
+ */
+struct FrameSnapshot
+{
+    FrameSnapshot() : line(0) {};
+
+    QString fullname;
+    int line;
+    QStringList argNames;
+    QStringList argValues;
+    QString localVarsFrame; //!< The frame that the variable objects of the locals was created in (or empty).
+    QStringList localNames; //!< The locals that there are variable objects for.
+    QList<LocalVar> locals;
+};
     
 
 
-class Core : public ComListener
+class Core : public ComListener, public ComResultListener
 {
 private:
     Q_OBJECT;
@@ -173,9 +226,24 @@ private:
      void onConsoleStreamOutput(QString str);
      void onTargetStreamOutput(QString str);
      void onLogStreamOutput(QString str);
+     void onCommandResult(int token, GdbResult result, Tree &tree);
 
     void dispatchBreakpointTree(Tree &tree);
-    static ICore::StopReason parseReasonString(QString string);
+    void removeBreakPoint(int number);
+    void unindexBreakPoint(BreakPoint *bkpt);
+    void addBreakPointChange(BreakPoint *bkpt, bool isRemoved);
+    void notifyBreakPointChanges();
+    void dispatchStackFrames();
+    QList<SourceFile*> updateSourceFiles(Tree &resultData);
+    SourceFile *addSourceFile(TreeNode *fileNode);
+    void updateLocalVars();
+    void restoreFrame(const FrameSnapshot &frame, bool showLocation);
+    void clearFrameCache();
+    int gdbReadMemoryPages(uint64_t firstPage, uint64_t lastPage);
+    void invalidateMemory(uint64_t addr, uint64_t len);
+    void clearMemoryCache();
+    void storeFrameInfo(Tree &tree);
+    static ICore::StopReason parseReason(const TreeNode *reasonNode);
     
 public:
     int gdbSetBreakpointAtFunc(QString func);
@@ -184,22 +252,22 @@ public:
     void gdbStepOut();
     void gdbContinue();
     void gdbRun();
-    bool gdbGetFiles();
+    void gdbGetFiles();
     int gdbAddVarWatch(QString varName, QString *varType, QString *value, QString *watchId, bool *hasChildren);
     void gdbRemoveVarWatch(QString watchId);
     QString gdbGetVarWatchName(QString watchId);
     int gdbSetBreakpoint(QString filename, int lineNo);
-    void gdbGetThreadList();
-    void getStackFrames();
+    int gdbSetBreakpoints(QList<SettingsBreakpoint> bkptList);
     void stop();
-    void gdbExpandVarWatchChildren(QString watchId);
+    bool gdbExpandVarWatchChildren(QString watchId, int from = 0, int count = -1);
     int gdbGetMemory(uint64_t addr, size_t count, QByteArray *data);
     
     void selectThread(int threadId);
     void selectFrame(int selectedFrameIdx);
 
     // Breakpoints
-    QList<BreakPoint*> getBreakPoints() { return m_breakpoints; };
+    QList<BreakPoint*> getBreakPoints() { return m_breakpoints.values(); };
+    QList<int> getBreakPointLines(QString fullPath);
     BreakPoint* findBreakPoint(QString fullPath, int lineNo);
     BreakPoint* findBreakPointByNumber(int number);
     void gdbRemoveBreakpoint(BreakPoint* bkpt);
@@ -208,29 +276,49 @@ public:
     QList<ThreadInfo> getThreadList();
     
 
-    QVector <SourceFile*> getSourceFiles() { return m_sourceFiles; };
+    const QHash<QString, SourceFile*> &getSourceFiles() { return m_sourceFiles; };
 
 
     void excute(QString cmd);
 private slots:
         void onGdbOutput(int socketNr);
+        void onTargetOutputTimeout();
 
 private:
     ICore *m_inf;
-    QList<BreakPoint*> m_breakpoints;
-    QVector <SourceFile*> m_sourceFiles;
+    QMap<int, BreakPoint*> m_breakpoints; //!< The breakpoints indexed by their number.
+    QHash<QString, QMultiMap<int, BreakPoint*> > m_fileBreakpoints; //!< The breakpoints indexed by file and line.
+    QHash<QString, SourceFile*> m_sourceFiles; //!< The source files indexed by their full path.
+    QSet<QString> m_scannedObjfiles; //!< The objfiles (Eg: "/lib/libc.so.6") that all the source files has been added for.
+    bool m_isGroupByObjfile; //!< False if GDB is too old to support '--group-by-objfile'.
     QMap <int, ThreadInfo> m_threadList;
     int m_selectedThreadId;
     ICore::TargetState m_targetState;
     ICore::TargetState m_lastTargetState;
     int m_pid;
     int m_currentFrameIdx;
+    QList<StackFrameEntry> m_stackFrames; //!< The stack of the selected thread (0=newest frame).
+    FrameSnapshot m_frame; //!< The selected frame.
     QMap <QString, VarWatch> m_watchList;
     int m_varWatchLastId;
     bool m_isRemote; //!< True if "remote target" or false if it is a "local target".
     int m_ptsFd;
     bool m_scanSources; //!< True if the source filelist may have changed
+    int m_sourceFilesToken; //!< Token of the source filelist request in flight (or 0).
+    QStringList m_frameLocalNames; //!< The locals of the selected frame (from -stack-list-locals).
+    QMap <int, QString> m_localVarTokens; //!< The locals being created indexed by the token of their -var-create.
+    QMap <QPair<int,int>, FrameSnapshot> m_frameCache; //!< Frames that has been selected since the target stopped (indexed by thread id and frame level).
+    QMap <int, QList<StackFrameEntry> > m_stackCache; //!< Stacks of threads that has been selected since the target stopped.
+    QStringList m_staleVarIds; //!< Variable objects to delete the next time the target stops.
+    QSet<int> m_breakpointTokens; //!< The -break-insert commands of gdbSetBreakpoints() in flight.
+    int m_breakpointFailCount; //!< Number of the commands in m_breakpointTokens that failed.
+    bool m_isBreakpointBatch; //!< True if ICore_onBreakpointsChanged() should be held back.
+    QList<BreakPointChange> m_breakpointChanges; //!< The changes held back while m_isBreakpointBatch is set.
+    QHash<uint64_t, QByteArray> m_memoryCache; //!< Memory of the target indexed by page number (only the part that can be read from the start of the page).
     QSocketNotifier  *m_ptsListener;
+    RingBuffer m_targetOutput; //!< Output from the target that has not been shown yet.
+    QTimer m_targetOutputTimer; //!< Passes m_targetOutput on to the GUI a number of times per second.
+    QTextDecoder m_targetOutputDecoder;
 
 };
 
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#include "filetreemodel.h"
+
+#include <QtAlgorithms>
+#include <assert.h>
+
+#include "util.h"
+
+
+FileTreeItem::FileTreeItem(FileTreeItem *parent, QString name)
+    : m_name(name)
+    ,m_parent(parent)
+    ,m_row(0)
+{
+}
+
+
+FileTreeItem::~FileTreeItem()
+{
+    for(int i = 0;i < m_children.size();i++)
+        delete m_children[i];
+}
+
+
+/**
+ * @brief Returns a child directory (which is added if it does not exist).
+ */
+FileTreeItem *FileTreeItem::addDir(QString name)
+{
+    FileTreeItem *item = m_childIndex.value(name, NULL);
+    if(item == NULL)
+    {
+        item = new FileTreeItem(this, name);
+        m_children.append(item);
+        m_childIndex[name] = item;
+    }
+    return item;
+}
+
+
+/**
+ * @brief Adds a file to a directory (unless there already is one with the same name).
+ */
+void FileTreeItem::addFile(QString name, QString fullPath)
+{
+    if(m_childIndex.contains(name))
+        return;
+
+    FileTreeItem *item = new FileTreeItem(this, name);
+    item->m_fullPath = fullPath;
+    m_children.append(item);
+    m_childIndex[name] = item;
+}
+
+
+/**
+ * @brief Shrinks the tree by merging the top directories that only has one subdirectory. Eg: "/usr/include/bits" => "/usr...bits".
+ */
+void FileTreeItem::wrapDirs()
+{
+    for(int u = 0;u < m_children.size();u++)
+    {
+        FileTreeItem *rootItem = m_children[u];
+        if(rootItem->m_children.isEmpty())
+            continue;
+
+        QString newName = "/" + rootItem->m_name;
+        while(rootItem->m_children.size() == 1 && !rootItem->m_children[0]->m_children.isEmpty())
+        {
+            FileTreeItem *childItem = rootItem->m_children[0];
+            newName += "/" + childItem->m_name;
+
+            rootItem->m_children = childItem->m_children;
+            for(int i = 0;i < rootItem->m_children.size();i++)
+                rootItem->m_children[i]->m_parent = rootItem;
+            childItem->m_children.clear();
+            delete childItem;
+        }
+        rootItem->m_name = newName;
+    }
+}
+
+
+bool FileTreeItem::lessThan(const FileTreeItem *a, const FileTreeItem *b)
+{
+    return a->m_name < b->m_name;
+}
+
+
+/**
+ * @brief Sorts the children by name (recursively).
+ *
+ * Also drops the name index that is only needed while the tree is built.
+ */
+void FileTreeItem::sortChildren()
+{
+    m_childIndex.clear();
+
+    qSort(m_children.begin(), m_children.end(), lessThan);
+    for(int i = 0;i < m_children.size();i++)
+    {
+        m_children[i]->m_row = i;
+        m_children[i]->sortChildren();
+    }
+}
+
+
+
+
+FileTreeWorker::FileTreeWorker()
+    : m_hasWork(false)
+    ,m_quit(false)
+{
+    qRegisterMetaType<FileTreeItem*>("FileTreeItem*");
+}
+
+
+FileTreeWorker::~FileTreeWorker()
+{
+    requestQuit();
+    wait();
+}
+
+
+void FileTreeWorker::requestQuit()
+{
+    QMutexLocker locker(&m_mutex);
+    m_quit = true;
+    m_wait.wakeAll();
+}
+
+
+/**
+ * @brief Asks for a tree to be built.
+ *
+ * A build that has not been started yet is replaced.
+ * @param ignoreDirs    The files that starts with any of these are left out.
+ */
+void FileTreeWorker::queueBuild(QStringList fileList, QStringList ignoreDirs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_fileList = fileList;
+    m_ignoreDirs = ignoreDirs;
+    m_hasWork = true;
+    m_wait.wakeAll();
+}
+
+
+void FileTreeWorker::run()
+{
+    m_mutex.lock();
+    while(!m_quit)
+    {
+        if(!m_hasWork)
+        {
+            m_wait.wait(&m_mutex);
+            continue;
+        }
+
+        QStringList fileList = m_fileList;
+        QStringList ignoreDirs = m_ignoreDirs;
+        m_hasWork = false;
+        m_mutex.unlock();
+
+        QStringList keptFiles;
+        FileTreeItem *root = build(fileList, ignoreDirs, &keptFiles);
+
+        m_mutex.lock();
+
+        // Already replaced by a newer list?
+        if(m_hasWork || m_quit)
+            delete root;
+        else
+            emit onBuildDone(root, keptFiles);
+    }
+    m_mutex.unlock();
+}
+
+
+/**
+ * @brief Builds the directory tree of a list of files.
+ * @param keptFiles    Set to the files that was not ignored.
+ */
+FileTreeItem *FileTreeWorker::build(QStringList fileList, QStringList ignoreDirs, QStringList *keptFiles)
+{
+    FileTreeItem *root = new FileTreeItem(NULL, "");
+
+    // Sort the lists so that the files in an ignored directory follow each other
+    qSort(fileList);
+    qSort(ignoreDirs);
+
+    // Remove the directories that are inside another ignored directory
+    QStringList prefixes;
+    for(int j = 0;j < ignoreDirs.size();j++)
+    {
+        QString ignoreDir = ignoreDirs[j];
+        if(ignoreDir.isEmpty())
+            continue;
+        if(!prefixes.isEmpty() && ignoreDir.startsWith(prefixes.last()))
+            continue;
+        prefixes.append(ignoreDir);
+    }
+
+    int prefixIdx = 0;
+    for(int i = 0;i < fileList.size();i++)
+    {
+        const QString &fullPath = fileList[i];
+
+        // Ignore directory? (a file that is past a directory is also past all the files in it)
+        while(prefixIdx < prefixes.size() && prefixes[prefixIdx] < fullPath && !fullPath.startsWith(prefixes[prefixIdx]))
+            prefixIdx++;
+        if(prefixIdx < prefixes.size() && fullPath.startsWith(prefixes[prefixIdx]))
+            continue;
+
+        keptFiles->append(fullPath);
+
+        // Get parent path
+        QString folderPath;
+        QString filename;
+        dividePath(fullPath, &filename, &folderPath);
+
+        // Add the directories
+        FileTreeItem *dirItem = root;
+        QStringList dirNames = folderPath.split('/', QString::SkipEmptyParts);
+        for(int k = 0;k < dirNames.size();k++)
+        {
+            QString dirName = dirNames[k];
+            if(dirName == ".")
+                continue;
+
+            // Handle "../" paths
+            if(dirName == ".." && dirItem != root)
+                dirItem = dirItem->getParent();
+            else
+                dirItem = dirItem->addDir(dirName);
+        }
+
+        dirItem->addFile(filename, fullPath);
+    }
+
+    root->wrapDirs();
+    root->sortChildren();
+
+    return root;
+}
+
+
+
+
+FileTreeModel::FileTreeModel()
+    : m_root(new FileTreeItem(NULL, ""))
+{
+}
+
+
+FileTreeModel::~FileTreeModel()
+{
+    delete m_root;
+}
+
+
+void FileTreeModel::setIcons(QIcon folderIcon, QIcon fileIcon)
+{
+    m_folderIcon = folderIcon;
+    m_fileIcon = fileIcon;
+}
+
+
+/**
+ * @brief Replaces all the items with a new tree.
+ *
+ * The model takes the ownership of the tree.
+ */
+void FileTreeModel::setRoot(FileTreeItem *root)
+{
+    assert(root != NULL);
+
+    beginResetModel();
+    delete m_root;
+    m_root = root;
+    endResetModel();
+}
+
+
+FileTreeItem *FileTreeModel::getItem(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return m_root;
+    return static_cast<FileTreeItem*>(index.internalPointer());
+}
+
+
+QModelIndex FileTreeModel::getIndex(FileTreeItem *item) const
+{
+    if(item == m_root)
+        return QModelIndex();
+    return createIndex(item->getRow(), 0, item);
+}
+
+
+QModelIndex FileTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    FileTreeItem *parentItem = getItem(parent);
+    if(row < 0 || row >= parentItem->getChildCount() || column != 0)
+        return QModelIndex();
+    return createIndex(row, column, parentItem->getChild(row));
+}
+
+
+QModelIndex FileTreeModel::parent(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return QModelIndex();
+    FileTreeItem *item = getItem(index);
+    return getIndex(item->getParent());
+}
+
+
+int FileTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.column() > 0)
+        return 0;
+    return getItem(parent)->getChildCount();
+}
+
+
+int FileTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+
+bool FileTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    return rowCount(parent) > 0;
+}
+
+
+QVariant FileTreeModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid())
+        return QVariant();
+
+    FileTreeItem *item = getItem(index);
+    if(role == Qt::DisplayRole)
+        return item->m_name;
+    if(role == Qt::DecorationRole)
+        return item->isDir() ? m_folderIcon : m_fileIcon;
+    return QVariant();
+}
+
+
+Qt::ItemFlags FileTreeModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+
+QVariant FileTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 0)
+        return QString("Name");
+    return QVariant();
+}
+
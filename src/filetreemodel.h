@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#ifndef FILE__FILE_TREE_MODEL_H
+#define FILE__FILE_TREE_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QIcon>
+
+
+/**
+ * @brief A directory or a file in a FileTreeModel.
+ */
+class FileTreeItem
+{
+public:
+    FileTreeItem(FileTreeItem *parent, QString name);
+    ~FileTreeItem();
+
+    FileTreeItem *getParent() const { return m_parent; };
+    int getRow() const { return m_row; };
+    int getChildCount() const { return m_children.size(); };
+    FileTreeItem *getChild(int i) const { return m_children[i]; };
+    bool isDir() const { return m_fullPath.isEmpty(); };
+
+    FileTreeItem *addDir(QString name);
+    void addFile(QString name, QString fullPath);
+    void wrapDirs();
+    void sortChildren();
+
+public:
+    QString m_name; //!< Eg: "main.c" or "src".
+    QString m_fullPath; //!< The path of a file (empty for a directory).
+
+private:
+    static bool lessThan(const FileTreeItem *a, const FileTreeItem *b);
+
+private:
+    FileTreeItem *m_parent;
+    int m_row; //!< The index of the item among the children of the parent.
+    QVector<FileTreeItem*> m_children;
+    QHash<QString, FileTreeItem*> m_childIndex; //!< The children indexed by name (only used while the tree is built).
+
+private:
+    FileTreeItem(const FileTreeItem &) {};
+};
+
+
+/**
+ * @brief Builds the directory tree of the source files.
+ *
+ * The tree is built in a thread of its own so that the GUI is not blocked
+ * by projects with tens of thousands of files.
+ */
+class FileTreeWorker : public QThread
+{
+    Q_OBJECT
+
+    public:
+        FileTreeWorker();
+        virtual ~FileTreeWorker();
+
+        void run();
+
+        void requestQuit();
+        void queueBuild(QStringList fileList, QStringList ignoreDirs);
+
+    private:
+        FileTreeItem *build(QStringList fileList, QStringList ignoreDirs, QStringList *keptFiles);
+
+    signals:
+        /**
+         * @brief Emitted when a tree has been built (the receiver takes the ownership of the tree).
+         * @param fileList    The files in the tree (sorted).
+         */
+        void onBuildDone(FileTreeItem *root, QStringList fileList);
+
+    private:
+        QMutex m_mutex;
+        QWaitCondition m_wait;
+        bool m_hasWork; //!< True if m_fileList and m_ignoreDirs has not been built yet.
+        QStringList m_fileList;
+        QStringList m_ignoreDirs;
+        bool m_quit;
+};
+
+
+/**
+ * @brief Model of the source file view.
+ *
+ * The view only asks for the rows of the directories that are expanded,
+ * so no widget items are created for the rest of the files.
+ */
+class FileTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    FileTreeModel();
+    ~FileTreeModel();
+
+    void setIcons(QIcon folderIcon, QIcon fileIcon);
+    void setRoot(FileTreeItem *root);
+
+    FileTreeItem *getRoot() { return m_root; };
+    FileTreeItem *getItem(const QModelIndex &index) const;
+    QModelIndex getIndex(FileTreeItem *item) const;
+
+    // QAbstractItemModel
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+private:
+    FileTreeItem *m_root;
+    QIcon m_folderIcon;
+    QIcon m_fileIcon;
+};
+
+
+#endif // FILE__FILE_TREE_MODEL_H
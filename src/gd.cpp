@@ -41,11 +41,9 @@ static int dumpUsage()
  */
 void loadBreakpoints(Settings &cfg, Core &core)
 {
-    for(int i = 0;i < cfg.m_breakpoints.size();i++)
-    {
-        SettingsBreakpoint bkptCfg = cfg.m_breakpoints[i];
-        core.gdbSetBreakpoint(bkptCfg.filename, bkptCfg.lineNo);
-    }
+    int failCount = core.gdbSetBreakpoints(cfg.m_breakpoints);
+    if(failCount > 0)
+        infoMsg("Failed to restore %d breakpoints", failCount);
 }
 
     
@@ -133,8 +131,6 @@ int main(int argc, char *argv[])
     // Set the status line
     w.setStatusLine(cfg);
 
-    w.insertSourceFiles();
-
     if(cfg.m_reloadBreakpoints)
         loadBreakpoints(cfg, core);
 
@@ -17,12 +17,15 @@ HEADERS+=mainwindow.h
 SOURCES+=codeview.cpp
 HEADERS+=codeview.h
 
-SOURCES+=gdbmiparser.cpp core.cpp
-HEADERS+=gdbmiparser.h core.h
+SOURCES+=core.cpp
+HEADERS+=core.h
 
 SOURCES+=com.cpp
 HEADERS+=com.h
 
+SOURCES+=linebuffer.cpp ringbuffer.cpp
+HEADERS+=linebuffer.h ringbuffer.h
+
 SOURCES+=log.cpp
 HEADERS+=log.h
 
@@ -32,6 +35,9 @@ HEADERS+=util.h
 SOURCES+=tree.cpp
 HEADERS+=tree.h
 
+SOURCES+=atom.cpp
+HEADERS+=atom.h
+
 SOURCES+=aboutdialog.cpp
 HEADERS+=aboutdialog.h
 
@@ -50,10 +56,13 @@ HEADERS+=settings.h
 SOURCES+=tagscanner.cpp tagmanager.cpp
 HEADERS+=tagscanner.h   tagmanager.h
 
+SOURCES+=filetreemodel.cpp
+HEADERS+=filetreemodel.h
+
 HEADERS+=config.h
 
-SOURCES+=varctl.cpp watchvarctl.cpp autovarctl.cpp
-HEADERS+=varctl.h watchvarctl.h autovarctl.h
+SOURCES+=varctl.cpp watchvarctl.cpp autovarctl.cpp vartreemodel.cpp
+HEADERS+=varctl.h watchvarctl.h autovarctl.h vartreemodel.h
 
 SOURCES+=settingsdialog.cpp
 HEADERS+=settingsdialog.h
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#include "linebuffer.h"
+
+#include <string.h>
+#include <assert.h>
+
+
+#define INITIAL_CAPACITY    (256*1024)
+#define MIN_WRITE_ROOM      (4*1024)
+
+
+LineBuffer::LineBuffer()
+    : m_data(NULL)
+    ,m_capacity(0)
+    ,m_head(0)
+    ,m_tail(0)
+    ,m_scanPos(0)
+{
+
+}
+
+
+LineBuffer::~LineBuffer()
+{
+}
+
+
+/**
+ * @brief Makes sure that there is room for len more characters after the unread data.
+ */
+void LineBuffer::makeRoom(int len)
+{
+    if(m_tail+len <= m_capacity)
+        return;
+
+    int used = m_tail-m_head;
+    int newCapacity = INITIAL_CAPACITY;
+    while(newCapacity < used+len)
+        newCapacity *= 2;
+
+    // Nobody else holds the buffer? Then move the unread data to the start of it.
+    if(newCapacity == m_capacity && m_buff.isDetached())
+    {
+        if(used > 0)
+            memmove(m_data, m_data+m_head, used);
+    }
+    else
+    {
+        // Move the unread data to a new buffer (the old one may still be held by the users of the lines)
+        QByteArray newBuff;
+        newBuff.resize(newCapacity);
+        char *newData = newBuff.data();
+        if(used > 0)
+            memcpy(newData, m_data+m_head, used);
+        m_buff = newBuff;
+        m_data = newData;
+        m_capacity = newCapacity;
+    }
+
+    m_scanPos -= m_head;
+    m_tail = used;
+    m_head = 0;
+}
+
+
+/**
+ * @brief Adds characters to the end of the buffer.
+ */
+void LineBuffer::append(const char *data, int len)
+{
+    if(len <= 0)
+        return;
+    makeRoom(len);
+    memcpy(m_data+m_tail, data, len);
+    m_tail += len;
+}
+
+
+/**
+ * @brief Returns a buffer where characters can be written.
+ * @param maxLen  The max number of characters that will be written.
+ * @param len     Set to the number of characters that fits (at most maxLen).
+ *
+ * The characters actually written must be added with commitWrite().
+ */
+char *LineBuffer::getWriteBuffer(int maxLen, int *len)
+{
+    // All data consumed? Drop a buffer that has grown or start over from the beginning of it.
+    if(m_head == m_tail && m_head > 0)
+    {
+        if(m_capacity > INITIAL_CAPACITY)
+            clear();
+        else if(m_buff.isDetached())
+            m_head = m_tail = m_scanPos = 0;
+    }
+
+    if(m_capacity-m_tail < qMin(maxLen, MIN_WRITE_ROOM))
+        makeRoom(maxLen);
+    *len = qMin(maxLen, m_capacity-m_tail);
+    return m_data+m_tail;
+}
+
+
+void LineBuffer::commitWrite(int len)
+{
+    assert(m_tail+len <= m_capacity);
+    if(len > 0)
+        m_tail += len;
+}
+
+
+/**
+ * @brief Checks if a complete line has been received.
+ */
+bool LineBuffer::hasLine()
+{
+    if(m_scanPos >= m_tail)
+        return false;
+    if(memchr(m_data+m_scanPos, '\n', m_tail-m_scanPos) != NULL)
+        return true;
+    m_scanPos = m_tail;
+    return false;
+}
+
+
+/**
+ * @brief Takes the next complete line out of the buffer.
+ * @param line    Set to the start of the line (not null terminated).
+ * @param len     Set to the length of the line (without the newline).
+ * @return true if a line was found.
+ */
+bool LineBuffer::takeLine(const char **line, int *len)
+{
+    if(m_scanPos >= m_tail)
+        return false;
+    const char *newline = (const char*)memchr(m_data+m_scanPos, '\n', m_tail-m_scanPos);
+    if(newline == NULL)
+    {
+        m_scanPos = m_tail;
+        return false;
+    }
+    *line = m_data+m_head;
+    *len = newline-(m_data+m_head);
+    m_head = newline-m_data+1;
+    m_scanPos = m_head;
+    return true;
+}
+
+
+void LineBuffer::clear()
+{
+    m_buff = QByteArray();
+    m_data = NULL;
+    m_capacity = 0;
+    m_head = 0;
+    m_tail = 0;
+    m_scanPos = 0;
+}
+
+
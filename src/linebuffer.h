@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#ifndef FILE__LINEBUFFER_H
+#define FILE__LINEBUFFER_H
+
+#include <QByteArray>
+
+
+/**
+ * @brief Buffer that splits a stream of characters into lines.
+ *
+ * Data can be appended in chunks of any size and lines are taken out as
+ * soon as they are complete. A partial line is kept (and is not scanned
+ * again) until the rest of it has been appended.
+ *
+ * The unread data is moved to the start of the buffer when the end is
+ * reached instead of wrapping around, so that a line is always stored
+ * contiguously and can be used in place. While a copy of getBuffer() is
+ * held the data is moved to a new buffer instead, so the characters of a
+ * line that has been taken out stay valid as long as the copy is held.
+ * A buffer that has grown to hold a long line is dropped once it has been
+ * consumed.
+ */
+class LineBuffer
+{
+public:
+    LineBuffer();
+    ~LineBuffer();
+
+    void append(const char *data, int len);
+    char *getWriteBuffer(int maxLen, int *len);
+    void commitWrite(int len);
+
+    bool takeLine(const char **line, int *len);
+    bool hasLine();
+    
+    int size() const { return m_tail-m_head; };
+    const QByteArray &getBuffer() const { return m_buff; };
+    void clear();
+
+private:
+    void makeRoom(int len);
+    
+private:
+    QByteArray m_buff; //!< Shared with the users of the lines (see getBuffer()).
+    char *m_data; //!< The characters of m_buff (written without detaching it).
+    int m_capacity;
+    int m_head; //!< Start of the unread data.
+    int m_tail; //!< End of the unread data.
+    int m_scanPos; //!< Position up to which the unread data has been searched for a newline.
+
+private:
+    LineBuffer(const LineBuffer &) {};
+};
+
+
+#endif // FILE__LINEBUFFER_H
+
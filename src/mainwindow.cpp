@@ -20,6 +20,7 @@
 #include <QDirIterator>
 #include <QMessageBox>
 #include <QScrollBar>
+#include <QTextCursor>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -35,6 +36,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     m_fileIcon.addFile(QString::fromUtf8(":/images/res/file.png"), QSize(), QIcon::Normal, QIcon::Off);
     m_folderIcon.addFile(QString::fromUtf8(":/images/res/folder.png"), QSize(), QIcon::Normal, QIcon::Off);
+    m_fileTreeModel.setIcons(m_folderIcon, m_fileIcon);
 
     
 
@@ -59,16 +61,16 @@ MainWindow::MainWindow(QWidget *parent)
 
 
     //
-    QTreeWidget *treeWidget = m_ui.treeWidget_file;
-    names.clear();
-    names += "Name";
-    treeWidget->setHeaderLabels(names);
-    treeWidget->setColumnCount(1);
-    treeWidget->setColumnWidth(0, 200);
+    m_ui.treeWidget_file->setModel(&m_fileTreeModel);
+    m_ui.treeWidget_file->setColumnWidth(0, 200);
+
+    connect(&m_fileTreeWorker, SIGNAL(onBuildDone(FileTreeItem*,QStringList)), this,
+                SLOT(onFileTreeBuilt(FileTreeItem*,QStringList)));
+    m_fileTreeWorker.start();
 
 
     //
-    treeWidget = m_ui.treeWidget_threads;
+    QTreeWidget *treeWidget = m_ui.treeWidget_threads;
     names.clear();
     names += "Name";
     treeWidget->setHeaderLabels(names);
@@ -123,7 +125,7 @@ MainWindow::MainWindow(QWidget *parent)
 
      
 
-    connect(m_ui.treeWidget_file, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(onFolderViewItemActivated(QTreeWidgetItem*,int)));
+    connect(m_ui.treeWidget_file, SIGNAL(activated(const QModelIndex&)), this, SLOT(onFolderViewItemActivated(const QModelIndex&)));
 
     connect(m_ui.actionQuit, SIGNAL(triggered()), SLOT(onQuit()));
     connect(m_ui.actionStop, SIGNAL(triggered()), SLOT(onStop()));
@@ -137,6 +139,11 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(m_ui.actionSettings, SIGNAL(triggered()), SLOT(onSettings()));
 
+    m_saveBreakpointsTimer.setSingleShot(true);
+    m_saveBreakpointsTimer.setInterval(500);
+    connect(&m_saveBreakpointsTimer, SIGNAL(timeout()), SLOT(onSaveBreakpointsTimeout()));
+    connect(QApplication::instance(), SIGNAL(aboutToQuit()), SLOT(onSaveBreakpointsTimeout()));
+
     
 
     Core &core = Core::getInstance();
@@ -207,241 +214,76 @@ void MainWindow::ICore_onStopped(ICore::StopReason reason, QString path, int lin
     
     updateCurrentLine(path, lineNo);
     
-
-    fillInStack();
 }
 
 
 void MainWindow::ICore_onLocalVarReset()
 {
-    QTreeWidget *autoWidget = m_ui.autoWidget;
-
-    autoWidget->clear();
+    m_autoVarCtl.ICore_onLocalVarReset();
 }
 
 /**
- * @brief Finds a child to a treewidget node.
+ * @brief Adds source files to the source file treeview.
+ *
+ * The tree is built by m_fileTreeWorker and shown when it is done (see onFileTreeBuilt).
  */
-QTreeWidgetItem *findTreeWidgetChildByName(QTreeWidget *treeWidget, QTreeWidgetItem *parent, QString name)
+void MainWindow::insertSourceFiles(QList<SourceFile*> sourceFiles)
 {
-    QTreeWidgetItem *foundItem = NULL;
-    if(parent == NULL)
-        parent = treeWidget->invisibleRootItem();
+    for(int i = 0;i < sourceFiles.size();i++)
+        m_sourceFilePaths.append(sourceFiles[i]->fullName);
 
-    for(int i = 0;i < parent->childCount() && foundItem == NULL;i++)
-    {
-        QTreeWidgetItem *childItem = parent->child(i);
-        if(childItem->text(0) == name)
-            foundItem = childItem;
-    }
-    return foundItem;
+    m_fileTreeWorker.queueBuild(m_sourceFilePaths, m_cfg.m_sourceIgnoreDirs);
 }
 
-    
+
 /**
- * @brief Adds a path of directories to a tree widget.
- * @return returns the root directory of the newly created directories.
+ * @brief A new source file tree has been built.
+ *
+ * Only the new files are scanned for tags.
+ * @param fileList    The files that was not ignored.
  */
-QTreeWidgetItem *MainWindow::addTreeWidgetPath(QTreeWidget *treeWidget, QTreeWidgetItem *parent, QString path)
+void MainWindow::onFileTreeBuilt(FileTreeItem *root, QStringList fileList)
 {
-    QString firstName;
-    QString restPath;
-    QTreeWidgetItem *newItem = NULL;
-
-
-    // Divide the path into a folder and name part.
-    firstName = path;
-    int divPos = path.indexOf('/');
-    if(divPos != -1)
-    {
-        firstName = path.left(divPos);        
-        restPath = path.mid(divPos+1);
-    }
-
-    // Handle "../" paths
-    if(firstName == ".." && parent != NULL)
-    {
-        return addTreeWidgetPath(treeWidget, parent->parent(), restPath);
-    }
-    
-    // Empty name and only a path?
-    if(firstName.isEmpty())
-    {
-        if(restPath.isEmpty())
-            return NULL;
-        else
-            return addTreeWidgetPath(treeWidget, parent, restPath);
-    }
-        
-//    debugMsg("inserting: '%s', '%s'\n", stringToCStr(firstName), stringToCStr(restPath));
-
-
-    // Check if the item already exist?
-    newItem = findTreeWidgetChildByName(treeWidget, parent, firstName);
-
-    
-    
+    m_fileTreeModel.setRoot(root);
 
-    // Add the item
-    if(newItem == NULL)
+    // Expand the top directories (except for the system directories)
+    for(int i = 0;i < root->getChildCount();i++)
     {
-        newItem = new QTreeWidgetItem;
-        newItem->setText(0, firstName); 
-        newItem->setIcon(0, m_folderIcon);
-    }
-    if(parent == NULL)
-    {
-        treeWidget->insertTopLevelItem(0, newItem);
-    }
-    else
-    {
-        parent->addChild(newItem);
-        if(parent->text(0) != "usr" && parent->text(0) != "opt")
-            parent->setExpanded(true);
+        FileTreeItem *item = root->getChild(i);
+        if(item->isDir() && !item->m_name.startsWith("/usr") && !item->m_name.startsWith("/opt"))
+            m_ui.treeWidget_file->expand(m_fileTreeModel.getIndex(item));
     }
 
-    if(restPath.isEmpty())
-        return newItem;
-    else
-        return addTreeWidgetPath(treeWidget, newItem, restPath);
-}
-
+    QSet<QString> oldFiles;
+    for(int i = 0;i < m_sourceFiles.size();i++)
+        oldFiles.insert(m_sourceFiles[i].fullName);
 
-/**
- * @brief Try to shrink a tree by removing dirs in the tree. Eg: "/usr/include/bits" => "/usr...bits".
- */ 
-void MainWindow::wrapSourceTree(QTreeWidget *treeWidget)
-{
-    for(int u = 0;u < treeWidget->topLevelItemCount();u++)
+    m_sourceFiles.clear();
+    for(int i = 0;i < fileList.size();i++)
     {
-        QTreeWidgetItem* rootItem = treeWidget->topLevelItem (u);
-        QTreeWidgetItem* childItem = rootItem->child(0);
-        QString newName =  "/" + rootItem->text(0);
-        if(!childItem)
-            continue;
-        
-        do
-        {
-            if(childItem->childCount() > 0 && rootItem->childCount() == 1)
-            {
-                newName += "/" + childItem->text(0);
-                QList<QTreeWidgetItem *> subChildren = childItem->takeChildren();
-                childItem = rootItem->takeChild(0);
-                delete childItem;
-                rootItem->addChildren(subChildren);
-
-                childItem = subChildren.first();
-            }
-        }
-        while(childItem->childCount() > 0 && rootItem->childCount() == 1);
-
-        if(rootItem->text(0) != "usr")
-            rootItem->setExpanded(true);
+        FileInfo info;
+        info.name = getFilenamePart(fileList[i]);
+        info.fullName = fileList[i];
 
-        rootItem->setText(0, newName);
+        m_sourceFiles.push_back(info);
 
+        if(!oldFiles.contains(info.fullName))
+            m_tagManager.queueScan(info.fullName);
     }
 }
 
 
-/**
- * @brief Fills in the source file treeview.
- */
-void MainWindow::insertSourceFiles()
-{
-    QTreeWidget *treeWidget = m_ui.treeWidget_file;
-    Core &core = Core::getInstance();
-
-    m_tagManager.abort();
-
-    treeWidget->clear();
     
-    // Get source files
-    QVector <SourceFile*> sourceFiles = core.getSourceFiles();
-    m_sourceFiles.clear();
-    for(int i = 0;i < sourceFiles.size();i++)
-    {
-        SourceFile* source = sourceFiles[i];
-
-        // Ignore directory?
-        bool ignore = false;
-        for(int j = 0;j < m_cfg.m_sourceIgnoreDirs.size();j++)
-        {
-            QString ignoreDir = m_cfg.m_sourceIgnoreDirs[j];
-            if(!ignoreDir.isEmpty())
-            {
-                if(source->fullName.startsWith(ignoreDir))
-                    ignore = true;
-            }
-        }
-
-        if(!ignore)
-        {
-            FileInfo info;
-            info.name = source->name;
-            info.fullName = source->fullName;
-            
-            m_sourceFiles.push_back(info);
-        }
-    }
-
     
-
-    for(int i = 0;i < m_sourceFiles.size();i++)
-    {
-        FileInfo &info = m_sourceFiles[i];
-
-        m_tagManager.queueScan(info.fullName);
-        
-
-        QTreeWidgetItem *parentNode  = NULL;
-
-        // Get parent path
-        QString folderPath;
-        QString filename;
-        dividePath(info.fullName, &filename, &folderPath);
-        folderPath = simplifyPath(folderPath);
-        
-        if(!folderPath.isEmpty())
-            parentNode = addTreeWidgetPath(treeWidget, NULL, folderPath);
-            
-
-        // Check if the item already exist?
-        QTreeWidgetItem *item = findTreeWidgetChildByName(treeWidget, parentNode, filename);
-        
-        if(item == NULL)
-        {
-            item = new QTreeWidgetItem;
-            item->setText(0, filename);
-            item->setData(0, Qt::UserRole, info.fullName);
-            item->setIcon(0, m_fileIcon);
-            
-            if(parentNode == NULL)
-                treeWidget->insertTopLevelItem(0, item);
-            else
-            {
-                parentNode->addChild(item);
-                parentNode->setExpanded(true);
-            }
-        }
-    }
-
-    wrapSourceTree(treeWidget);
-
-    treeWidget->sortItems(0, Qt::AscendingOrder);
-
+void MainWindow::ICore_onLocalVarChanged(QString varId, QString name, QString value, QString varType, bool hasChildren)
+{
+    m_autoVarCtl.ICore_onLocalVarChanged(varId, name, value, varType, hasChildren);
 }
 
 
-
-
-
-
-    
-    
-void MainWindow::ICore_onLocalVarChanged(QString name, CoreVarValue varValue)
+void MainWindow::ICore_onLocalVarListDone()
 {
-    m_autoVarCtl.ICore_onLocalVarChanged(name, varValue);
+    m_autoVarCtl.ICore_onLocalVarListDone();
 }
 
 
@@ -460,9 +302,9 @@ void MainWindow::ICore_onWatchVarChildAdded(QString watchId, QString name, QStri
 }
 
 
-void MainWindow::ICore_onSourceFileListChanged()
+void MainWindow::ICore_onSourceFileListChanged(QList<SourceFile*> addedFiles)
 {
-    insertSourceFiles();
+    insertSourceFiles(addedFiles);
 }
 
 /**
@@ -499,13 +341,6 @@ void MainWindow::ICore_onMessage(QString message)
 }
     
 
-void MainWindow::fillInStack()
-{
-    Core &core = Core::getInstance();
-    
-    core.getStackFrames();
-
-}
 
 
 void
@@ -550,16 +385,11 @@ void MainWindow::onStackWidgetSelectionChanged()
 
 
 
-void MainWindow::onFolderViewItemActivated ( QTreeWidgetItem * item, int column )
+void MainWindow::onFolderViewItemActivated(const QModelIndex &index)
 {
-    Q_UNUSED(column);
-
-    if(item->childCount() == 0)
-    {
-        QString filename  = item->data(0, Qt::UserRole).toString();
-
-        open(filename);
-    }
+    FileTreeItem *item = m_fileTreeModel.getItem(index);
+    if(!item->isDir())
+        open(item->m_fullPath);
 }
 
 CodeViewTab* MainWindow::currentTab()
@@ -585,9 +415,9 @@ void MainWindow::onBreakpointsEnableDisable(QTreeWidgetItem *item, int column)
 {
     if (column == 5) {
         Core &core = Core::getInstance();
-        QList<BreakPoint*>  bklist = core.getBreakPoints();
-        int i = item->data(0, Qt::UserRole).toInt();
-        BreakPoint* bk = bklist[i];
+        BreakPoint* bk = core.findBreakPointByNumber(item->data(0, Qt::UserRole).toInt());
+        if(bk == NULL)
+            return;
         bk->enabled = !bk->enabled;
         core.gdbEnableBreakpoint(bk, bk->enabled);
     }
@@ -643,6 +473,8 @@ CodeViewTab* MainWindow::open(QString filename)
         // Add the new codeview tab
         m_ui.editorTabWidget->addTab(codeViewTab, getFilenamePart(filename));
         m_ui.editorTabWidget->setCurrentIndex(m_ui.editorTabWidget->count()-1);
+
+        codeViewTab->setBreakpoints(Core::getInstance().getBreakPointLines(filename));
     }
     
     // Set window title
@@ -652,9 +484,6 @@ CodeViewTab* MainWindow::open(QString filename)
     windowTitle.sprintf("%s - %s",  stringToCStr(filenamePart), stringToCStr(folderPathPart));
     setWindowTitle(windowTitle);
 
-
-    ICore_onBreakpointsChanged();
-
     return codeViewTab;
 }
 
@@ -712,6 +541,20 @@ void MainWindow::updateCurrentLine(QString filename, int lineno)
 }
 
  
+/**
+ * @brief Stores the current breakpoints in the settings file.
+ */
+void MainWindow::onSaveBreakpointsTimeout()
+{
+    if(!m_saveBreakpointsTimer.isActive() && sender() != &m_saveBreakpointsTimer)
+        return;
+    m_saveBreakpointsTimer.stop();
+
+    m_cfg.m_breakpoints = m_breakpointSettings.values();
+    m_cfg.save();
+}
+
+
 void MainWindow::onQuit()
 {
     QApplication::instance()->quit();
@@ -774,29 +617,35 @@ void MainWindow::onStepOut()
 }
 
 
-void MainWindow::ICore_onThreadListChanged()
+/**
+ * @brief Threads has been created, changed or has exited.
+ *
+ * Only the items of the threads in the lists are updated.
+ */
+void MainWindow::ICore_onThreadListChanged(QList<ThreadInfo> changedThreads, QList<int> removedThreadIds)
 {
-    Core &core = Core::getInstance();
-
     QTreeWidget *threadWidget = m_ui.treeWidget_threads;
-    threadWidget->clear();
 
-    QList<ThreadInfo> list = core.getThreadList();
-    
-    for(int idx = 0;idx < list.size();idx++)
+    for(int idx = 0;idx < removedThreadIds.size();idx++)
+        delete m_threadItems.take(removedThreadIds[idx]);
+
+    for(int idx = 0;idx < changedThreads.size();idx++)
     {
         // Get name
-        QString name = list[idx].m_name;
-        
+        QString name = changedThreads[idx].m_name;
+        int threadId = changedThreads[idx].id;
 
         // Add the item
-        QStringList names;
-        names.push_back(name);
-        QTreeWidgetItem *item = new QTreeWidgetItem(names);
-        item->setData(0, Qt::UserRole, list[idx].id);
-        item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-        threadWidget->insertTopLevelItem(0, item);
-
+        QTreeWidgetItem *item = m_threadItems.value(threadId, NULL);
+        if(item == NULL)
+        {
+            item = new QTreeWidgetItem();
+            item->setData(0, Qt::UserRole, threadId);
+            item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+            threadWidget->insertTopLevelItem(0, item);
+            m_threadItems[threadId] = item;
+        }
+        item->setText(0, name);
     }
 }
 
@@ -823,70 +672,103 @@ void MainWindow::ICore_onCurrentThreadChanged(int threadId)
 
 
 
-void MainWindow::ICore_onBreakpointsChanged()
+/**
+ * @brief Fills in the columns of an item in the breakpoint list.
+ */
+void MainWindow::setBreakpointItem(QTreeWidgetItem *item, BreakPoint *bk)
+{
+    QString name;
+    item->setText(0, QString::number(bk->m_number));
+    item->setText(1, getFilenamePart(bk->fullname));
+    item->setText(2, bk->m_funcName);
+    name.sprintf("%d", bk->lineNo);
+    item->setText(3, name);
+    item->setText(4, longLongToHexString(bk->m_addr));
+    if (bk->enabled) {
+        item->setCheckState(5, Qt::Checked);
+    } else {
+        item->setCheckState(5, Qt::Unchecked);
+    }
+}
+
+
+/**
+ * @brief Breakpoints has been added, changed or removed.
+ *
+ * Only the items in the breakpoint list and the rows in the code views
+ * that the changes affect are updated.
+ */
+void MainWindow::ICore_onBreakpointsChanged(QList<BreakPointChange> changes)
 {
     Core &core = Core::getInstance();
-    QList<BreakPoint*>  bklist = core.getBreakPoints();
     
 
-    // Update the settings
-    m_cfg.m_breakpoints.clear();
-    for(int u = 0;u < bklist.size();u++)
+    // Update the settings (they are written to disk once the changes has settled)
+    for(int i = 0;i < changes.size();i++)
     {
-        BreakPoint* bkpt = bklist[u];
-        SettingsBreakpoint bkptCfg;
-        bkptCfg.filename = bkpt->fullname;
-        bkptCfg.lineNo = bkpt->lineNo;
-        m_cfg.m_breakpoints.push_back(bkptCfg);
+        const BreakPointChange &change = changes[i];
+        BreakPoint* bk = core.findBreakPointByNumber(change.number);
+        if(bk == NULL)
+            m_breakpointSettings.remove(change.number);
+        else
+        {
+            SettingsBreakpoint bkptCfg;
+            bkptCfg.filename = bk->fullname;
+            bkptCfg.lineNo = bk->lineNo;
+            m_breakpointSettings[change.number] = bkptCfg;
+        }
     }
-    m_cfg.save();
+    if(!changes.isEmpty())
+        m_saveBreakpointsTimer.start();
     
 
-    // Update the breakpoint list widget
-    m_ui.treeWidget_breakpoints->clear();
-    for(int i = 0;i <  bklist.size();i++)
+    // Update the breakpoint list widget and find the rows to repaint
+    QMap<QString, QSet<int> > changedRows;
+    for(int i = 0;i < changes.size();i++)
     {
-        BreakPoint* bk = bklist[i];
-
-        QStringList nameList;
-        QString name;
-        nameList.append(QString::number(bk->m_number));
-        nameList.append(getFilenamePart(bk->fullname));
-        nameList.append(bk->m_funcName);
-        name.sprintf("%d", bk->lineNo);
-        nameList.append(name);
-        nameList.append(longLongToHexString(bk->m_addr));
-        
+        const BreakPointChange &change = changes[i];
+        BreakPoint* bk = core.findBreakPointByNumber(change.number);
 
-        QTreeWidgetItem *item = new QTreeWidgetItem(nameList);
-        item->setData(0, Qt::UserRole, i);
-        item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-        if (bk->enabled) {
-            item->setCheckState(5, Qt::Checked);
-        } else {
-            item->setCheckState(5, Qt::Unchecked);
+        if(!change.oldFullname.isEmpty())
+            changedRows[change.oldFullname].insert(change.oldLineNo);
+
+        QTreeWidgetItem *item = m_breakpointItems.value(change.number, NULL);
+        if(bk == NULL)
+        {
+            m_breakpointItems.remove(change.number);
+            delete item;
+            continue;
         }
+        changedRows[bk->fullname].insert(bk->lineNo);
 
-        // Add the item to the widget
-        m_ui.treeWidget_breakpoints->insertTopLevelItem(0, item);
+        if(item == NULL)
+        {
+            item = new QTreeWidgetItem();
+            item->setData(0, Qt::UserRole, bk->m_number);
+            item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+            m_breakpointItems[bk->m_number] = item;
 
+            // Add the item to the widget
+            m_ui.treeWidget_breakpoints->insertTopLevelItem(0, item);
+        }
+        setBreakpointItem(item, bk);
     }
 
     // Update the fileview
     for(int tabIdx = 0;tabIdx <  m_ui.editorTabWidget->count();tabIdx++)
     {
         CodeViewTab* codeViewTab = (CodeViewTab* )m_ui.editorTabWidget->widget(tabIdx);
+        QString filePath = codeViewTab->getFilePath();
+        if(!changedRows.contains(filePath))
+            continue;
 
-        QVector<int> numList;
-        for(int i = 0;i <  bklist.size();i++)
+        const QSet<int> &rows = changedRows[filePath];
+        QSet<int>::const_iterator rowItr = rows.constBegin();
+        for (;rowItr != rows.constEnd();++rowItr)
         {
-            BreakPoint* bk = bklist[i];
-
-            if(bk->fullname == codeViewTab->getFilePath())
-                numList.push_back(bk->lineNo);
+            int lineNo = *rowItr;
+            codeViewTab->setBreakpoint(lineNo, core.findBreakPoint(filePath, lineNo) != NULL);
         }
-
-        codeViewTab->setBreakpoints(numList);
     }
 }
 
@@ -978,9 +860,9 @@ void MainWindow::onBreakpointsWidgetItemDoubleClicked(QTreeWidgetItem * item,int
     Q_UNUSED(column);
 
     Core &core = Core::getInstance();
-    QList<BreakPoint*>  bklist = core.getBreakPoints();
-    int idx = item->data(0, Qt::UserRole).toInt();
-    BreakPoint* bk = bklist[idx];
+    BreakPoint* bk = core.findBreakPointByNumber(item->data(0, Qt::UserRole).toInt());
+    if(bk == NULL)
+        return;
 
     CodeViewTab* currentCodeViewTab = open(bk->fullname);
     if(currentCodeViewTab)
@@ -1281,6 +1163,7 @@ void MainWindow::setConfig()
 
     m_outputFont = QFont(m_cfg.m_outputFontFamily, m_cfg.m_outputFontSize);
     m_ui.targetOutputView->setFont(m_outputFont);
+    m_ui.targetOutputView->setMaximumBlockCount(m_cfg.m_outputScrollback);
     
     m_autoVarCtl.setConfig(&m_cfg);
 
@@ -1316,21 +1199,46 @@ void MainWindow::ICore_onSignalReceived(QString signalName)
     
     onCurrentLineDisabled();
         
-    fillInStack();
 
 }
 
+/**
+ * @brief Adds output from the target to the end of the target output view.
+ *
+ * The output is not split into lines so a line may be continued by the next call.
+ */
 void MainWindow::ICore_onTargetOutput(QString message)
 {
-    if(message.endsWith("\n"))
-    {
-        message = message.left(message.length()-1);
-    }
-    if(message.endsWith("\r"))
+    QPlainTextEdit *outputView = m_ui.targetOutputView;
+
+    // Skip the lines that would be removed by the scrollback limit anyway
+    int maxLineCount = m_cfg.m_outputScrollback;
+    if(maxLineCount > 0)
     {
-        message = message.left(message.length()-1);
+        int lineCount = 0;
+        int pos = message.length();
+        while(pos > 0 && (pos = message.lastIndexOf('\n', pos-1)) != -1)
+        {
+            if(++lineCount >= maxLineCount)
+            {
+                message = message.mid(pos+1);
+                break;
+            }
+        }
     }
-    m_ui.targetOutputView->appendPlainText(message);    
+
+    message.remove('\r');
+
+    // Keep following the output unless the user has scrolled up
+    QScrollBar *scrollBar = outputView->verticalScrollBar();
+    bool isAtEnd = scrollBar->value() == scrollBar->maximum();
+
+    QTextCursor cursor(outputView->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(message);
+
+    if(isAtEnd)
+        scrollBar->setValue(scrollBar->maximum());
 }
 
 
@@ -1345,13 +1253,16 @@ void MainWindow::ICore_onStateChanged(TargetState state)
     m_ui.actionRun->setEnabled((state == TARGET_STOPPED &&  m_cfg.m_attachMode == false) ? true : false);
 
     m_ui.varWidget->setEnabled(state == TARGET_STOPPED ? true : false);
+    m_ui.autoWidget->setEnabled(state == TARGET_STOPPED ? true : false);
 
     
     if(state == TARGET_RUNNING)
     {
         m_ui.treeWidget_stack->clear();
-        m_ui.autoWidget->clear();
     }
+
+    // The locals are kept while running so that they can be updated in place
+    m_autoVarCtl.ICore_onStateChanged(state);
 }
 
 
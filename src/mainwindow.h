@@ -13,6 +13,7 @@
 #include <QApplication>
 #include <QMap>
 #include <QLabel>
+#include <QTimer>
 
 #include "ui_mainwindow.h"
 #include "core.h"
@@ -23,6 +24,7 @@
 #include "watchvarctl.h"
 #include "codeviewtab.h"
 #include "tagmanager.h"
+#include "filetreemodel.h"
 
 
 class FileInfo
@@ -43,17 +45,18 @@ public:
     
 
 public:
-    void insertSourceFiles();
+    void insertSourceFiles(QList<SourceFile*> sourceFiles);
     void setStatusLine(Settings &cfg);
     
 public:
     void ICore_onStopped(ICore::StopReason reason, QString path, int lineNo);
     void ICore_onLocalVarReset();
-    void ICore_onLocalVarChanged(QString name, CoreVarValue varValue);
+    void ICore_onLocalVarChanged(QString varId, QString name, QString value, QString varType, bool hasChildren);
+    void ICore_onLocalVarListDone();
     void ICore_onWatchVarChanged(QString watchId, QString name, QString value, bool hasChildren);
     void ICore_onConsoleStream(QString text);
-    void ICore_onBreakpointsChanged();
-    void ICore_onThreadListChanged();
+    void ICore_onBreakpointsChanged(QList<BreakPointChange> changes);
+    void ICore_onThreadListChanged(QList<ThreadInfo> changedThreads, QList<int> removedThreadIds);
     void ICore_onCurrentThreadChanged(int threadId);
     void ICore_onStackFrameChange(QList<StackFrameEntry> stackFrameList);
     void ICore_onFrameVarReset();
@@ -63,7 +66,7 @@ public:
     void ICore_onSignalReceived(QString sigtype);
     void ICore_onTargetOutput(QString msg);
     void ICore_onStateChanged(TargetState state);
-    void ICore_onSourceFileListChanged();
+    void ICore_onSourceFileListChanged(QList<SourceFile*> addedFiles);
     
     void ICodeView_onRowDoubleClick(int lineNo);
     void ICodeView_onContextMenu(QPoint pos, int lineNo, QStringList text);
@@ -78,10 +81,6 @@ public:
 private:
     void setConfig();
     
-    void wrapSourceTree(QTreeWidget *treeWidget);
-
-    QTreeWidgetItem *addTreeWidgetPath(QTreeWidget *treeWidget, QTreeWidgetItem *parent, QString path);
-    void fillInStack();
 
     bool eventFilter(QObject *obj, QEvent *event);
     void loadConfig();
@@ -100,10 +99,12 @@ private:
     void updateCurrentLine(QString filename, int lineno);
     void onCurrentLineChanged(int lineno);
     void onCurrentLineDisabled();
+    void setBreakpointItem(QTreeWidgetItem *item, BreakPoint *bk);
 
 
 public slots:
-    void onFolderViewItemActivated ( QTreeWidgetItem * item, int column );
+    void onFolderViewItemActivated(const QModelIndex &index);
+    void onFileTreeBuilt(FileTreeItem *root, QStringList fileList);
     void onThreadWidgetSelectionChanged( );
     void onStackWidgetSelectionChanged();
     void onQuit();
@@ -125,6 +126,7 @@ public slots:
     void onCodeViewTab_currentChanged( int tabIdx);
     void onCmd_returnPressed();
     void onBreakpointsEnableDisable(QTreeWidgetItem * item,int column);
+    void onSaveBreakpointsTimeout();
     
 private:
     Ui_MainWindow m_ui;
@@ -138,12 +140,19 @@ private:
     Settings m_cfg;
     TagManager m_tagManager;
     QList<FileInfo> m_sourceFiles;
+    QStringList m_sourceFilePaths; //!< All the source files reported by gdb (including the ignored ones).
+    FileTreeModel m_fileTreeModel;
+    FileTreeWorker m_fileTreeWorker;
 
     AutoVarCtl m_autoVarCtl;
     WatchVarCtl m_watchVarCtl;
     QFont m_outputFont;
     QFont m_gdbOutputFont;
     QLabel m_statusLineWidget;
+    QHash<int, QTreeWidgetItem*> m_breakpointItems; //!< The items in the breakpoint list indexed by breakpoint number.
+    QHash<int, QTreeWidgetItem*> m_threadItems; //!< The items in the thread list indexed by thread id.
+    QMap<int, SettingsBreakpoint> m_breakpointSettings; //!< The breakpoints to store in the settings indexed by breakpoint number.
+    QTimer m_saveBreakpointsTimer; //!< Coalesces the saves of the settings when breakpoints change.
 };
 
 
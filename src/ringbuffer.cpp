@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#include "ringbuffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+RingBuffer::RingBuffer(int capacity)
+    : m_capacity(capacity)
+    ,m_head(0)
+    ,m_size(0)
+    ,m_droppedCount(0)
+{
+    assert(capacity > 0);
+    m_buff = (char*)malloc(capacity);
+}
+
+
+RingBuffer::~RingBuffer()
+{
+    free(m_buff);
+}
+
+
+/**
+ * @brief Appends characters (the oldest ones are dropped if there is no room).
+ */
+void RingBuffer::append(const char *data, int len)
+{
+    // Only the end of the data fits?
+    if(len > m_capacity)
+    {
+        m_droppedCount += len-m_capacity;
+        data += len-m_capacity;
+        len = m_capacity;
+    }
+
+    // Make room by dropping the oldest characters
+    int overflow = m_size+len-m_capacity;
+    if(overflow > 0)
+    {
+        m_head = (m_head+overflow) % m_capacity;
+        m_size -= overflow;
+        m_droppedCount += overflow;
+    }
+
+    int tail = (m_head+m_size) % m_capacity;
+    int firstLen = len < m_capacity-tail ? len : m_capacity-tail;
+    memcpy(m_buff+tail, data, firstLen);
+    memcpy(m_buff, data+firstLen, len-firstLen);
+    m_size += len;
+}
+
+
+/**
+ * @brief Takes out the oldest characters.
+ * @return The number of characters copied to data.
+ */
+int RingBuffer::take(char *data, int maxLen)
+{
+    int len = maxLen < m_size ? maxLen : m_size;
+    int firstLen = len < m_capacity-m_head ? len : m_capacity-m_head;
+    memcpy(data, m_buff+m_head, firstLen);
+    memcpy(data+firstLen, m_buff, len-firstLen);
+
+    m_head = (m_head+len) % m_capacity;
+    m_size -= len;
+    return len;
+}
+
+
+void RingBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+    m_droppedCount = 0;
+}
+
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#ifndef FILE__RINGBUFFER_H
+#define FILE__RINGBUFFER_H
+
+
+/**
+ * @brief Buffer of characters with a fixed capacity.
+ *
+ * When the buffer is full the oldest characters are overwritten, so a
+ * producer that is faster than the consumer can not make it grow.
+ */
+class RingBuffer
+{
+public:
+    RingBuffer(int capacity);
+    ~RingBuffer();
+
+    void append(const char *data, int len);
+    int take(char *data, int maxLen);
+
+    int size() const { return m_size; };
+    bool isEmpty() const { return m_size == 0; };
+    int getDroppedCount() const { return m_droppedCount; };
+    void clear();
+
+private:
+    char *m_buff;
+    int m_capacity;
+    int m_head; //!< Start of the unread data.
+    int m_size; //!< Number of unread characters.
+    int m_droppedCount; //!< Number of characters that has been overwritten before they were read.
+
+private:
+    RingBuffer(const RingBuffer &) {};
+};
+
+
+#endif // FILE__RINGBUFFER_H
+
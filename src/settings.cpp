@@ -33,6 +33,7 @@ void Settings::loadDefaultsGui()
     m_outputFontSize = 8;
     m_gdbOutputFontFamily = "Monospace";
     m_gdbOutputFontSize = 8;
+    m_outputScrollback = 10000;
 
 }
 
@@ -69,6 +70,7 @@ void Settings::loadGlobalConfig()
     m_outputFontSize = tmpIni.getInt("OutputFontSize", m_outputFontSize);
     m_gdbOutputFontFamily = tmpIni.getString("GdbOutputFont", m_outputFontFamily);
     m_gdbOutputFontSize = tmpIni.getInt("GdbOutputFontSize", m_outputFontSize);
+    m_outputScrollback = tmpIni.getInt("OutputScrollback", m_outputScrollback);
 
     m_sourceIgnoreDirs = tmpIni.getStringList("ScannerIgnoreDirs", m_sourceIgnoreDirs);
 
@@ -193,6 +195,7 @@ void Settings::saveGlobalConfig()
     tmpIni.setInt("OutputFontSize", m_outputFontSize);
     tmpIni.setString("GdbOutputFont", m_gdbOutputFontFamily);
     tmpIni.setInt("GdbOutputFontSize", m_gdbOutputFontSize);
+    tmpIni.setInt("OutputScrollback", m_outputScrollback);
 
     tmpIni.setStringList("ScannerIgnoreDirs", m_sourceIgnoreDirs);
 
@@ -70,6 +70,7 @@ class Settings
         int m_outputFontSize;
         QString m_gdbOutputFontFamily;
         int m_gdbOutputFontSize;
+        int m_outputScrollback; //!< Max number of lines of target output to keep (0=unlimited).
 
         QStringList m_sourceIgnoreDirs;
 
@@ -11,90 +11,519 @@
 #include "log.h"
 #include "util.h"
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <QAtomicInt>
 
-TreeNode::TreeNode()
-    : m_address(0)
+
+#define FIRST_NODE_BLOCK_SIZE   16
+#define MAX_NODE_BLOCK_SIZE     4096
+#define STRING_BLOCK_SIZE       1024
+#define NAME_TABLE_MIN_CHILDREN 16 //!< Nodes with fewer children are searched by name linearly.
+
+
+static QAtomicInt g_allocCount; //!< Number of TreeNode's created.
+
+
+TreeArena::TreeArena()
+    : m_blockIdx(0)
+    ,m_blockUsed(0)
+    ,m_strUsed(0)
+    ,m_strCapacity(0)
+    ,m_parser(NULL)
+    ,m_root(NULL)
+    ,m_refCount(1)
 {
+    m_root = allocNode();
+}
+
 
+TreeArena::~TreeArena()
+{
+    for(int i = 0;i < m_blocks.size();i++)
+        delete [] m_blocks[i];
+    for(int i = 0;i < m_strBlocks.size();i++)
+        free(m_strBlocks[i]);
 }
 
 
+/**
+ * @brief Allocates a new node without any children.
+ */
+TreeNode *TreeArena::allocNode()
+{
+    // Current block full?
+    while(m_blockIdx < m_blocks.size() && m_blockUsed == m_blockSizes[m_blockIdx])
+    {
+        m_blockIdx++;
+        m_blockUsed = 0;
+    }
+    if(m_blockIdx == m_blocks.size())
+    {
+        int blockSize = m_blocks.isEmpty() ? FIRST_NODE_BLOCK_SIZE : m_blockSizes.last()*2;
+        if(blockSize > MAX_NODE_BLOCK_SIZE)
+            blockSize = MAX_NODE_BLOCK_SIZE;
+        m_blocks.push_back(new TreeNode[blockSize]);
+        m_blockSizes.push_back(blockSize);
+    }
 
-void TreeNode::copy(const TreeNode &other)
+    TreeNode *node = m_blocks[m_blockIdx]+m_blockUsed;
+    m_blockUsed++;
+    node->init(this);
+    
+    g_allocCount.fetchAndAddRelaxed(1);
+    return node;
+}
+
+
+/**
+ * @brief Stores a copy of a string in the arena.
+ * @param str   The string to copy (or NULL to leave the memory uninitialized).
+ * @return The copy (not null terminated).
+ */
+const char *TreeArena::allocString(const char *str, int len)
 {
+    if(len <= 0)
+        return "";
 
-    // Remove all children
-    removeAll();
+    // Does not fit in the current block?
+    if(m_strBlocks.isEmpty() || m_strUsed+len > m_strCapacity)
+    {
+        // Big strings gets a block of their own
+        if(len > STRING_BLOCK_SIZE/4)
+        {
+            char *buff = (char*)malloc(len);
+            if(str)
+                memcpy(buff, str, len);
+            m_strBlocks.insert(m_strBlocks.isEmpty() ? 0 : m_strBlocks.size()-1, buff);
+            return buff;
+        }
+        m_strBlocks.push_back((char*)malloc(STRING_BLOCK_SIZE));
+        m_strCapacity = STRING_BLOCK_SIZE;
+        m_strUsed = 0;
+    }
+    char *buff = m_strBlocks.last()+m_strUsed;
+    if(str)
+        memcpy(buff, str, len);
+    m_strUsed += len;
+    return buff;
+}
 
-    // Set name and data
-    m_name = other.m_name;
-    m_data = other.m_data;
 
-    // Copy all children
-    for(int i = 0;i < other.m_children.size();i++)
+/**
+ * @brief Allocates a table of node pointers.
+ */
+TreeNode **TreeArena::allocTable(int count)
+{
+    int len = count*sizeof(TreeNode*);
+
+    // Align it in the current block
+    int pad = (sizeof(TreeNode*) - m_strUsed%sizeof(TreeNode*)) % sizeof(TreeNode*);
+    if(!m_strBlocks.isEmpty() && m_strUsed+pad+len <= m_strCapacity)
+        m_strUsed += pad;
+    else if(len <= STRING_BLOCK_SIZE/4)
     {
-        TreeNode* otherNode = other.m_children[i];
-        TreeNode* thisNode = new TreeNode;
-        thisNode->copy(*otherNode);
+        m_strBlocks.push_back((char*)malloc(STRING_BLOCK_SIZE));
+        m_strCapacity = STRING_BLOCK_SIZE;
+        m_strUsed = 0;
+    }
+    return (TreeNode**)allocString(NULL, len);
+}
+
+
+/**
+ * @brief Keeps a reference to a buffer that the nodes refers to.
+ */
+void TreeArena::holdBuffer(const QByteArray &buffer)
+{
+    m_buffers.push_back(buffer);
+}
+
+
+/**
+ * @brief Removes all nodes (except the root) and strings.
+ */
+void TreeArena::reset()
+{
+    // Keep the first blocks for reuse
+    for(int i = 1;i < m_blocks.size();i++)
+        delete [] m_blocks[i];
+    m_blocks.resize(1);
+    m_blockSizes.resize(1);
+    m_blockIdx = 0;
+    m_blockUsed = 0;
+
+    for(int i = 0;i < m_strBlocks.size();i++)
+        free(m_strBlocks[i]);
+    m_strBlocks.clear();
+    m_strUsed = 0;
+    m_strCapacity = 0;
+    
+    m_buffers.clear();
+
+    m_root = allocNode();
+}
+
+
+void TreeNode::init(TreeArena *arena)
+{
+    m_arena = arena;
+    m_name = "";
+    m_nameLen = 0;
+    m_nameHash = AtomTable::hash("", 0);
+    m_nameAtom = ATOM_NONE;
+    m_data = "";
+    m_dataLen = 0;
+    m_isCString = false;
+    m_isLazy = false;
+    m_address = 0;
+    m_childCount = 0;
+    m_firstChild = NULL;
+    m_lastChild = NULL;
+    m_nextSibling = NULL;
+    m_childTable = NULL;
+    m_childTableSize = 0;
+    m_nameTable = NULL;
+    m_nameTableBits = 0;
+    m_nameTableCount = 0;
+}
 
-        addChild(thisNode);
+
+/**
+ * @brief Returns the number of nodes that has been created so far.
+ */
+int TreeNode::getAllocCount()
+{
+    return g_allocCount.fetchAndAddRelaxed(0);
+}
+
+
+/**
+ * @brief Adds a new child last.
+ * @return The new child.
+ */
+TreeNode *TreeNode::addChild()
+{
+    if(m_isLazy)
+        expand();
+    
+    TreeNode *child = m_arena->allocNode();
+    if(m_lastChild)
+        m_lastChild->m_nextSibling = child;
+    else
+        m_firstChild = child;
+    m_lastChild = child;
+    m_childCount++;
+
+    // Keep the table up to date (it is grown by doubling it)
+    if(m_childTable)
+    {
+        if(m_childCount > m_childTableSize)
+        {
+            TreeNode **table = m_arena->allocTable(m_childTableSize*2);
+            memcpy(table, m_childTable, m_childTableSize*sizeof(TreeNode*));
+            m_childTable = table;
+            m_childTableSize *= 2;
+        }
+        m_childTable[m_childCount-1] = child;
     }
+    return child;
+}
+
 
+TreeNode *TreeNode::getChild(int i) const
+{
+    if(m_isLazy)
+        expand();
+    assert(0 <= i && i < m_childCount);
+    if(m_childTable == NULL)
+        buildChildTable();
+    return m_childTable[i];
 }
 
 
-QStringList TreeNode::getChildList() const
+/**
+ * @brief Creates the table used to find a child by its index.
+ *
+ * The children are only linked to each other while the tree is built.
+ */
+void TreeNode::buildChildTable() const
 {
-    QStringList list;
-    for(int i =0;i < m_children.size();i++)
+    TreeNode *self = const_cast<TreeNode*>(this);
+    TreeNode **table = m_arena->allocTable(m_childCount);
+    int idx = 0;
+    for(TreeNode *child = m_firstChild;child != NULL;child = child->m_nextSibling)
+        table[idx++] = child;
+    self->m_childTable = table;
+    self->m_childTableSize = m_childCount;
+}
+
+
+/**
+ * @brief Returns the key that a name is stored with in the name table.
+ */
+static inline uint32_t getNameKey(Atom atom, uint32_t hash)
+{
+    return atom != ATOM_NONE ? (uint32_t)atom : hash;
+}
+
+
+static inline uint32_t getNameSlot(uint32_t key, int bits)
+{
+    return (key*2654435761U) >> (32-bits);
+}
+
+
+/**
+ * @brief Adds the children that are not in the name table yet to it.
+ *
+ * The table uses open addressing and is kept at most half full. The
+ * children are added in order, so the first child with a name is found
+ * before any later child with the same name. The name of a child must not
+ * change once the children has been searched by name.
+ */
+void TreeNode::updateNameTable() const
+{
+    TreeNode *self = const_cast<TreeNode*>(this);
+
+    // Too small? Then create a new one with all the children.
+    if(m_nameTable == NULL || m_childCount*2 > (1<<m_nameTableBits))
     {
-        TreeNode* node = m_children[i];
-        assert(node != NULL);
-        list += node->getName();
+        int bits = 4;
+        while((1<<bits) < m_childCount*2)
+            bits++;
+        self->m_nameTable = m_arena->allocTable(1<<bits);
+        memset(self->m_nameTable, 0, (1<<bits)*sizeof(TreeNode*));
+        self->m_nameTableBits = bits;
+        self->m_nameTableCount = 0;
     }
-    return list;
+
+    uint32_t mask = (1<<m_nameTableBits)-1;
+    for(int i = m_nameTableCount;i < m_childCount;i++)
+    {
+        TreeNode *child = getChild(i);
+        uint32_t slot = getNameSlot(getNameKey(child->m_nameAtom, child->m_nameHash), m_nameTableBits);
+        while(m_nameTable[slot] != NULL)
+            slot = (slot+1) & mask;
+        m_nameTable[slot] = child;
+    }
+    self->m_nameTableCount = m_childCount;
+}
+
+
+/**
+ * @brief Sets the data to the unparsed text of the children (Eg: "{a="1",b="2"}").
+ *
+ * The text is parsed by the trees SubtreeParser when the children are
+ * accessed the first time.
+ */
+void TreeNode::setLazyValue(const char *str, int len)
+{
+    removeAll();
+    m_data = str;
+    m_dataLen = len;
+    m_isCString = false;
+    m_isLazy = true;
 }
 
 
-TreeNode::~TreeNode()
+/**
+ * @brief Parses the children of a lazy node.
+ */
+void TreeNode::expand() const
 {
-    for(int i = 0;i < m_children.size();i++)
+    TreeNode *self = const_cast<TreeNode*>(this);
+    SubtreeParser *parser = m_arena->getSubtreeParser();
+    const char *str = m_data;
+    int len = m_dataLen;
+
+    self->m_isLazy = false;
+    self->m_data = "";
+    self->m_dataLen = 0;
+    if(parser)
+        parser->parseSubtree(self, str, len);
+    else
+        errorMsg("No parser for lazy node");
+}
+
+
+QString TreeNode::getName() const
+{
+    return QString::fromUtf8(m_name, m_nameLen);
+}
+
+
+void TreeNode::setName(QString name)
+{
+    QByteArray str = name.toUtf8();
+    setName(m_arena->allocString(str.constData(), str.size()), str.size());
+}
+
+
+/**
+ * @brief Sets the name to a string that is owned by the tree.
+ */
+void TreeNode::setName(const char *str, int len)
+{
+    m_name = str;
+    m_nameLen = len;
+    m_nameHash = AtomTable::hash(str, len);
+    m_nameAtom = AtomTable::lookup(str, len, m_nameHash);
+}
+
+
+/**
+ * @brief Sets the name to one of the atoms (Eg: "name").
+ */
+void TreeNode::setName(Atom atom)
+{
+    m_name = AtomTable::getString(atom);
+    m_nameLen = AtomTable::getLength(atom);
+    m_nameHash = 0; // Only compared when looking for names that are not atoms
+    m_nameAtom = atom;
+}
+
+
+/**
+ * @brief Returns the atom of the data (Eg: ATOM_BREAKPOINT_HIT for "breakpoint-hit").
+ */
+Atom TreeNode::getDataAtom() const
+{
+    if(m_isLazy)
+        return ATOM_NONE;
+    return AtomTable::lookup(m_data, m_dataLen);
+}
+
+
+QString TreeNode::getData() const
+{
+    if(m_isLazy)
+        return "";
+    if(m_isCString)
+        return unescapeCString(m_data, m_dataLen);
+    return QString::fromUtf8(m_data, m_dataLen);
+}
+
+
+/**
+ * @brief Gets the data as it was received (UTF-8 and with any escape sequences left).
+ *
+ * Avoids the conversion to a QString for large data (Eg: the contents of a memory area).
+ */
+const char *TreeNode::getRawData(int *len) const
+{
+    if(m_isLazy)
     {
-        TreeNode* node = m_children[i];
-        delete node;
+        *len = 0;
+        return "";
     }
+    *len = m_dataLen;
+    return m_data;
+}
 
+
+void TreeNode::setData(QString data)
+{
+    QByteArray str = data.toUtf8();
+    setData(m_arena->allocString(str.constData(), str.size()), str.size(), false);
 }
 
 
+/**
+ * @brief Sets the data to a string that is owned by the tree.
+ * @param isCString   True if the string may contain C escape sequences (Eg: "\n").
+ */
+void TreeNode::setData(const char *str, int len, bool isCString)
+{
+    m_data = str;
+    m_dataLen = len;
+    m_isCString = isCString;
+}
+
+
+/**
+ * @brief Copies the content and all children of another node (possibly in another tree).
+ */
+void TreeNode::copy(const TreeNode &other)
+{
+    if(other.m_isLazy)
+        other.expand();
+
+    // Remove all children
+    removeAll();
+
+    // Set name and data
+    setName(m_arena->allocString(other.m_name, other.m_nameLen), other.m_nameLen);
+    setData(m_arena->allocString(other.m_data, other.m_dataLen), other.m_dataLen, other.m_isCString);
+    m_address = other.m_address;
+    
+    // Copy all children
+    for(TreeNode *otherNode = other.m_firstChild;otherNode != NULL;otherNode = otherNode->m_nextSibling)
+    {
+        TreeNode* thisNode = addChild();
+        thisNode->copy(*otherNode);
+    }
+
+}
+
+
+/**
+ * @brief Returns the names of all children.
+ *
+ * Use getFirstChild() and getNextSibling() to iterate the children without
+ * allocating the list.
+ */
+QStringList TreeNode::getChildList() const
+{
+    QStringList list;
+    for(TreeNode *node = getFirstChild();node != NULL;node = node->m_nextSibling)
+    {
+        list += node->getName();
+    }
+    return list;
+}
+
 
+/**
+ * @brief Removes all children. The memory is released together with the tree.
+ */
 void TreeNode::removeAll()
 {
-    for(int i = 0;i < m_children.size();i++)
+    m_childCount = 0;
+    m_firstChild = NULL;
+    m_lastChild = NULL;
+    m_childTable = NULL;
+    m_childTableSize = 0;
+    m_nameTable = NULL;
+    m_nameTableBits = 0;
+    m_nameTableCount = 0;
+    if(m_isLazy)
     {
-        TreeNode* node = m_children[i];
-        delete node;
+        m_isLazy = false;
+        m_data = "";
+        m_dataLen = 0;
     }
-    m_children.clear();
-        
 }
 
     
 
 void TreeNode::dump(int parentCnt)
 {
+#ifdef ENABLE_DEBUGMSG
     QString text;
-    text.sprintf("+- %s='%s' (0x%x)", stringToCStr(m_name),
-                        stringToCStr(m_data), m_address);
+    text.sprintf("+- %s='%s' (0x%x)", stringToCStr(getName()),
+                        stringToCStr(getData()), m_address);
 
     for(int i = 0;i < parentCnt;i++)
         text  = "    " + text;
     debugMsg("%s", stringToCStr(text));
-    for(int i = 0;i < (int)m_children.size();i++)
+    for(TreeNode *node = getFirstChild();node != NULL;node = node->m_nextSibling)
     {
-        TreeNode *node = m_children[i];
         node->dump(parentCnt+1);
     }
+#else
+    Q_UNUSED(parentCnt);
+#endif
 
 }
 
@@ -109,74 +538,162 @@ void TreeNode::dump()
 
 Tree::Tree()
 {
+    m_arena = new TreeArena;
 }
 
 
+Tree::~Tree()
+{
+    if(--m_arena->m_refCount == 0)
+        delete m_arena;
+}
 
 
 
-
-
+/**
+ * @brief Checks if the node has a specific (UTF-8 encoded) name.
+ */
+bool TreeNode::isNamed(const QByteArray &name) const
+{
+    return m_nameLen == name.size() && memcmp(m_name, name.constData(), m_nameLen) == 0;
+}
 
     
 TreeNode *TreeNode::findChild(QString path) const
 {
-    QString childName;
-    QString restPath;
-    int indexPos;
+    return TreePath(path).resolve(this);
+}
 
-    // Find the seperator in the string 
-    indexPos = path.indexOf('/');
-    if(indexPos == 0)
-        return findChild(path.mid(1));
 
-    // Get the first child name
-    if(indexPos == -1)
-        childName = path;
+TreeNode *TreeNode::findChild(const TreePath &path) const
+{
+    return path.resolve(this);
+}
+
+
+QString TreeNode::getString(const TreePath &path) const
+{
+    TreeNode *node = path.resolve(this);
+    if(node)
+        return node->getData();
+    return "";
+}
+
+
+int TreeNode::getInt(const TreePath &path, int defaultValue) const
+{
+    QString str = getString(path);
+    if(str.isEmpty())
+        return defaultValue;
     else
+        return str.toInt(0,0);
+}
+
+
+TreePath::TreePath(QString path)
+{
+    QStringList names = path.split('/', QString::SkipEmptyParts);
+    m_steps.resize(names.size());
+    for(int i = 0;i < names.size();i++)
     {
-        childName = path.left(indexPos);
-        restPath = path.mid(indexPos+1);
+        QString name = names[i];
+        Step &step = m_steps[i];
+        bool isNumber;
+        
+        if(name[0] == '#')
+        {
+            step.m_isIndex = true;
+            step.m_index = atoi(stringToCStr(name.mid(1)))-1;
+        }
+        else
+        {
+            step.m_name = name.toUtf8();
+            step.m_hash = AtomTable::hash(step.m_name.constData(), step.m_name.size());
+            step.m_atom = AtomTable::lookup(step.m_name.constData(), step.m_name.size(), step.m_hash);
+
+            // Items in a list are named after their position
+            int num = name.toInt(&isNumber, 10);
+            if(isNumber && num > 0 && name[0] != '0' && name[0] != '+')
+                step.m_index = num-1;
+        }
     }
+}
+
 
-    if(childName[0].toLatin1() == '#')
+/**
+ * @brief Checks if a node has the name of a step.
+ */
+bool TreePath::isMatch(const Step &step, const TreeNode *node)
+{
+    if(step.m_atom != ATOM_NONE)
+        return node->m_nameAtom == step.m_atom;
+    return node->m_nameHash == step.m_hash && node->isNamed(step.m_name);
+}
+
+
+/**
+ * @brief Finds the first child of a node that has the name of a step.
+ */
+TreeNode *TreePath::findNamed(const TreeNode *node, const Step &step)
+{
+    if(node->getChildCount() < NAME_TABLE_MIN_CHILDREN)
     {
-        QString numStr = childName.mid(1);
-        int idx = atoi(stringToCStr(numStr))-1;
-        if(0 <= idx  && idx < getChildCount())
+        for(TreeNode *child = node->getFirstChild();child != NULL;child = child->m_nextSibling)
         {
-            TreeNode *child = getChild(idx);
-            if(restPath.isEmpty())
+            if(isMatch(step, child))
                 return child;
-            else
-                return child->findChild(restPath);
         }
+        return NULL;
     }
-    else
-    {
-    // Look for the child
-    for(int u = 0;u < getChildCount();u++)
+
+    if(node->m_nameTableCount != node->m_childCount)
+        node->updateNameTable();
+    uint32_t mask = (1<<node->m_nameTableBits)-1;
+    uint32_t slot = getNameSlot(getNameKey(step.m_atom, step.m_hash), node->m_nameTableBits);
+    for(TreeNode *child = node->m_nameTable[slot];child != NULL;child = node->m_nameTable[slot])
     {
-        TreeNode *child = getChild(u);
+        if(isMatch(step, child))
+            return child;
+        slot = (slot+1) & mask;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Finds the node that the path refers to.
+ * @param node   The node that the path starts at.
+ * @return The node or NULL if it does not exist.
+ */
+TreeNode *TreePath::resolve(const TreeNode *node) const
+{
+    if(m_steps.isEmpty())
+        return NULL;
 
-        if(child->getName() == childName)
+    for(int i = 0;i < m_steps.size() && node != NULL;i++)
+    {
+        const Step &step = m_steps[i];
+        const TreeNode *child = NULL;
+        
+        // Try the child at the index first
+        if(0 <= step.m_index && step.m_index < node->getChildCount())
         {
-            if(restPath.isEmpty())
-                return child;
-            else
-                return child->findChild(restPath);
+            child = node->getChild(step.m_index);
+            if(!step.m_isIndex && !isMatch(step, child))
+                child = NULL;
         }
+        if(child == NULL && !step.m_isIndex)
+            child = findNamed(node, step);
+        node = child;
     }
-    }
-        
-    return NULL;
+    return (TreeNode*)node;
 }
 
 
 
 QString Tree::getString(QString path) const
 {
-    TreeNode *node = m_root.findChild(path);
+    TreeNode *node = m_arena->getRoot()->findChild(path);
     if(node)
         return node->getData();
     return "";
@@ -200,11 +717,39 @@ long long Tree::getLongLong(QString path) const
 }
 
 
+QString Tree::getString(const TreePath &path) const
+{
+    return m_arena->getRoot()->getString(path);
+}
+
+
+int Tree::getInt(const TreePath &path, int defaultValue) const
+{
+    return m_arena->getRoot()->getInt(path, defaultValue);
+}
+
+
+long long Tree::getLongLong(const TreePath &path) const
+{
+    QString str = getString(path);
+    return stringToLongLong(stringToCStr(str));
+}
+
+
+int Tree::getChildCount(const TreePath &path) const
+{
+    TreeNode *node = path.resolve(m_arena->getRoot());
+    if(node)
+        return node->getChildCount();
+    return 0;
+}
+
+
 
 int Tree::getChildCount(QString path) const
 {
     int cnt = 0;
-    TreeNode *node = m_root.findChild(path);
+    TreeNode *node = m_arena->getRoot()->findChild(path);
     if(node)
         cnt = node->getChildCount();
     return cnt;
@@ -213,7 +758,7 @@ int Tree::getChildCount(QString path) const
 QStringList Tree::getChildList(QString path) const
 {
     QStringList list;
-    TreeNode *node = m_root.findChild(path);
+    TreeNode *node = m_arena->getRoot()->findChild(path);
     if(node)
         list = node->getChildList();
     return list;
@@ -221,15 +766,48 @@ QStringList Tree::getChildList(QString path) const
 
 void Tree::removeAll()
 {
-    m_root.removeAll();
+    // Leave the nodes to the other trees that shares them
+    if(m_arena->m_refCount > 1)
+    {
+        m_arena->m_refCount--;
+        m_arena = new TreeArena;
+    }
+    else
+        m_arena->reset();
 }
 
 
 void Tree::copy(const Tree &other)
 {
-    m_root.copy(other.m_root);
+    removeAll();
+    getRoot()->copy(*other.m_arena->getRoot());
 
 }
 
 
-    
+/**
+ * @brief Makes the tree refer to the nodes of another tree without copying them.
+ *
+ * The nodes must not be modified while they are shared (except for lazy
+ * nodes being expanded, which the trees then share as well). removeAll()
+ * stops the sharing.
+ */
+void Tree::share(const Tree &other)
+{
+    if(m_arena == other.m_arena)
+        return;
+    if(--m_arena->m_refCount == 0)
+        delete m_arena;
+    m_arena = other.m_arena;
+    m_arena->m_refCount++;
+}
+
+
+/**
+ * @brief Exchanges the content with another tree without copying it.
+ */
+void Tree::swap(Tree &other)
+{
+    qSwap(m_arena, other.m_arena);
+}
+
@@ -13,48 +13,200 @@
 #include <QVector>
 #include <QList>
 #include <QStringList>
+#include <QByteArray>
 #include <stdint.h>
+#include "atom.h"
 
 
+class TreeArena;
+class TreePath;
+class TreeNode;
+
+
+/**
+ * @brief Parses the text of a subtree that was stored unparsed (see TreeNode::setLazyValue()).
+ */
+class SubtreeParser
+{
+public:
+    virtual void parseSubtree(TreeNode *node, const char *str, int len) = 0;
+};
+
+
+/**
+ * @brief A node in a Tree.
+ *
+ * Nodes are allocated from the arena of the tree that they belong to and
+ * are only valid as long as the tree is. The name and data are stored as
+ * UTF-8 slices of memory owned by the arena.
+ *
+ * A lazy node keeps the text of its children unparsed until they are
+ * accessed the first time.
+ */
 class TreeNode
 {
 public:
-    TreeNode();
-    virtual ~TreeNode();
-    
     TreeNode *findChild(QString path) const;
+    TreeNode *findChild(const TreePath &path) const;
+    QString getString(const TreePath &path) const;
+    int getInt(const TreePath &path, int defaultValue = 0) const;
 
     uint32_t getAddress() const { return m_address; };
     void setAddress(uint32_t addr) { m_address = addr; };
     
     QStringList getChildList() const;
-    void addChild(TreeNode *child) { m_children.push_back(child); };
-    TreeNode *getChild(int i) const { return m_children[i]; };
-    int getChildCount() const { return m_children.size(); };
-    QString getData() const { return m_data; };
-    void setData(QString data) { m_data = data; };
+    TreeNode *addChild();
+    TreeNode *getChild(int i) const;
+    int getChildCount() const { if(m_isLazy) expand(); return m_childCount; };
+    TreeNode *getFirstChild() const { if(m_isLazy) expand(); return m_firstChild; };
+    TreeNode *getNextSibling() const { return m_nextSibling; };
+    QString getData() const;
+    const char *getRawData(int *len) const;
+    void setData(QString data);
+    void setData(const char *str, int len, bool isCString);
+    void setLazyValue(const char *str, int len);
+    bool isLazy() const { return m_isLazy; };
     void dump();
 
-    void setName(QString name) { m_name = name; };
-    QString getName() const { return m_name; };
+    void setName(QString name);
+    void setName(const char *str, int len);
+    void setName(Atom atom);
+    QString getName() const;
+    Atom getNameAtom() const { return m_nameAtom; };
+    Atom getDataAtom() const;
 
     void removeAll();
 
-
-    void copy(const TreeNode &other);
+    static int getAllocCount();
+    
 private:
+    TreeNode() {};
+    void init(TreeArena *arena);
+    void expand() const;
+    void buildChildTable() const;
+    void updateNameTable() const;
+    void copy(const TreeNode &other);
     void dump(int parentCnt);
+    bool isNamed(const QByteArray &name) const;
+
+private:
+    TreeArena *m_arena; //!< The arena that the node was allocated from.
+    const char *m_name;
+    int m_nameLen;
+    uint32_t m_nameHash;
+    Atom m_nameAtom; //!< The atom of the name (or ATOM_NONE).
+    const char *m_data;
+    int m_dataLen;
+    bool m_isCString; //!< True if the data may contain C escape sequences.
+    bool m_isLazy; //!< True if the data is the unparsed text of the children.
+    uint32_t m_address;
+
+    int m_childCount;
+    TreeNode *m_firstChild;
+    TreeNode *m_lastChild;
+    TreeNode *m_nextSibling;
+    TreeNode **m_childTable; //!< The children indexed (or NULL if not built yet).
+    int m_childTableSize; //!< Number of entries allocated in m_childTable.
+    TreeNode **m_nameTable; //!< Hash table of the children by name (or NULL if not built yet).
+    int m_nameTableBits; //!< The size of m_nameTable as a power of two.
+    int m_nameTableCount; //!< Number of children that has been added to m_nameTable.
+
+    friend class TreeArena;
+    friend class Tree;
+    friend class TreePath;
+    
+private:
+    TreeNode(const TreeNode &) { };
+
+};
+
+
+/**
+ * @brief A path to a node (Eg: "frame/args/#2/name") that has been parsed once.
+ *
+ * A name in the path matches the child with the same name and "#N" matches
+ * the N:th child (starting at 1). Lookups with a TreePath takes O(1) per
+ * step (nodes with many children gets a hash table of the names the first
+ * time they are searched), so static instances should be used for paths
+ * that are looked up repeatedly.
+ */
+class TreePath
+{
+public:
+    explicit TreePath(QString path);
+
+    TreeNode *resolve(const TreeNode *node) const;
+
+private:
+    class Step;
+
+    static bool isMatch(const Step &step, const TreeNode *node);
+    static TreeNode *findNamed(const TreeNode *node, const Step &step);
 
+private:
+    class Step
+    {
+        public:
+            Step() : m_index(-1), m_hash(0), m_atom(ATOM_NONE), m_isIndex(false) {};
+
+            QByteArray m_name; //!< The name of the child (UTF-8 encoded).
+            int m_index; //!< Index of the child for "#N" steps and names that are numbers (else -1).
+            uint32_t m_hash;
+            Atom m_atom; //!< The atom of the name (or ATOM_NONE).
+            bool m_isIndex; //!< True for "#N" steps.
+    };
+    
+    QVector<Step> m_steps;
+};
 
+
+/**
+ * @brief Storage for the nodes and strings of a tree.
+ *
+ * The nodes are stored in a few contiguous blocks and are all released at
+ * once when the arena is reset or deleted. An arena may be shared by
+ * several trees (see Tree::share()).
+ */
+class TreeArena
+{
 public:
-    QString m_name;
-    QString m_data;
-    QVector<TreeNode*> m_children;
-    uint32_t m_address;
+    TreeArena();
+    ~TreeArena();
 
+    TreeNode *allocNode();
+    const char *allocString(const char *str, int len);
+    TreeNode **allocTable(int count);
+    void holdBuffer(const QByteArray &buffer);
+
+    void setSubtreeParser(SubtreeParser *parser) { m_parser = parser; };
+    SubtreeParser *getSubtreeParser() const { return m_parser; };
+    
+    void reset();
+
+    TreeNode *getRoot() { return m_root; };
+    
 private:
-        TreeNode(const TreeNode &) { };
+    QVector<TreeNode*> m_blocks; //!< Blocks of nodes.
+    QVector<int> m_blockSizes;
+    int m_blockIdx; //!< The block that nodes are currently allocated from.
+    int m_blockUsed; //!< Number of nodes used in the current block.
+    
+    QVector<char*> m_strBlocks; //!< Blocks of string characters.
+    int m_strUsed; //!< Number of characters used in the last string block.
+    int m_strCapacity; //!< Size of the last string block.
+    
+    QList<QByteArray> m_buffers; //!< Buffers that the nodes refers to.
+
+    SubtreeParser *m_parser; //!< Parser for the lazy nodes (or NULL).
 
+    TreeNode *m_root;
+
+    int m_refCount; //!< Number of trees that uses the arena (only shared by the thread that dispatches the results).
+    
+    friend class Tree;
+
+private:
+    TreeArena(const TreeArena &) {};
 };
 
 
@@ -65,24 +217,35 @@ class Tree
 {
 public:
     Tree();
+    ~Tree();
     
 
 
-    void dump() { m_root.dump();};
+    void dump() { getRoot()->dump();};
 
     
     QString getString(QString path) const;
     int getInt(QString path, int defaultValue = 0) const;
     long long getLongLong(QString path) const;
 
-    TreeNode *getChildAt(int idx) { return m_root.getChild(idx);};
-    int getRootChildCount() const { return m_root.getChildCount();};
+    QString getString(const TreePath &path) const;
+    int getInt(const TreePath &path, int defaultValue = 0) const;
+    long long getLongLong(const TreePath &path) const;
+    int getChildCount(const TreePath &path) const;
+    TreeNode *findChild(const TreePath &path) const { return path.resolve(m_arena->getRoot()); };
+
+    TreeNode *getChildAt(int idx) { return getRoot()->getChild(idx);};
+    int getRootChildCount() const { return m_arena->getRoot()->getChildCount();};
     int getChildCount(QString path) const;
     QStringList getChildList(QString path) const;
     
 
-    TreeNode* getRoot() { return &m_root; };
+    TreeNode* getRoot() { return m_arena->getRoot(); };
     void copy(const Tree &other);
+    void share(const Tree &other);
+    void swap(Tree &other);
+    void holdBuffer(const QByteArray &buffer) { m_arena->holdBuffer(buffer); };
+    void setSubtreeParser(SubtreeParser *parser) { m_arena->setSubtreeParser(parser); };
 
     void removeAll();
     
@@ -103,7 +266,7 @@ private:
     Tree(const Tree &) {}; 
 private:
 
-    TreeNode m_root;
+    TreeArena *m_arena;
 };
 
 #endif // FILE__TREE_H
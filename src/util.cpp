@@ -11,6 +11,12 @@
 #include <assert.h>
 #include <QString>
 #include <stdio.h>
+#include <string.h>
+#include <QByteArray>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -167,6 +173,86 @@ unsigned char hexStringToU8(const char *str)
     return d;
 }
 
+/**
+ * @brief Gets the value of a hex digit (or -1 if it is not one).
+ */
+static inline int hexDigitToInt(char c)
+{
+    if('0' <= c && c <= '9')
+        return c-'0';
+    c |= 0x20; // To lower case
+    if('a' <= c && c <= 'f')
+        return 0xa + (c-'a');
+    return -1;
+}
+
+
+/**
+ * @brief Converts a string of hex digits to bytes (Eg: "a0ff" => 0xa0,0xff).
+ *
+ * Uses SSE2 (if available) to convert 16 bytes at a time.
+ * @param data    Buffer with room for len/2 bytes.
+ * @return The number of bytes written (stops at the first pair with a character that is not a hex digit).
+ */
+int hexStringToBytes(const char *str, int len, unsigned char *data)
+{
+    int byteCount = len/2;
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i lowerCaseBit = _mm_set1_epi8(0x20);
+    const __m128i char0 = _mm_set1_epi8('0');
+    const __m128i charA = _mm_set1_epi8('a');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i five = _mm_set1_epi8(5);
+    const __m128i ten = _mm_set1_epi8(10);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+
+    for(;i+16 <= byteCount;i += 16)
+    {
+        __m128i values[2];
+        int validMask = 0xffff;
+        for(int half = 0;half < 2;half++)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i*)(str+i*2+half*16));
+
+            // '0'..'9' => 0..9 and 'a'..'f' (or 'A'..'F') => 10..15
+            __m128i digit = _mm_sub_epi8(c, char0);
+            __m128i isDigit = _mm_cmpeq_epi8(_mm_subs_epu8(digit, nine), zero);
+            __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, lowerCaseBit), charA);
+            __m128i isAlpha = _mm_cmpeq_epi8(_mm_subs_epu8(alpha, five), zero);
+            validMask &= _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha));
+
+            __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                                           _mm_and_si128(isAlpha, _mm_add_epi8(alpha, ten)));
+
+            // Merge each pair of nibbles (the first one is the high nibble)
+            values[half] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, lowByteMask), 4),
+                                        _mm_srli_epi16(nibbles, 8));
+        }
+
+        // Let the scalar loop find where the invalid character is
+        if(validMask != 0xffff)
+            break;
+
+        _mm_storeu_si128((__m128i*)(data+i), _mm_packus_epi16(values[0], values[1]));
+    }
+#endif
+
+    for(;i < byteCount;i++)
+    {
+        int high = hexDigitToInt(str[i*2]);
+        int low = hexDigitToInt(str[i*2+1]);
+        if(high < 0 || low < 0)
+            break;
+        data[i] = (high<<4) | low;
+    }
+
+    return i;
+}
+
+
 long long stringToLongLong(QString str)
 {
     return stringToLongLong(stringToCStr(str));
@@ -187,3 +273,41 @@ void testFuncs()
 }
 #endif
 
+
+
+/**
+ * @brief Converts a (UTF-8 encoded) C string with escape sequences (Eg: "\n" or "\302").
+ * @param str    The string without the quotes.
+ */
+QString unescapeCString(const char *str, int len)
+{
+    if(memchr(str, '\\', len) == NULL)
+        return QString::fromUtf8(str, len);
+
+    QByteArray unescaped;
+    unescaped.reserve(len);
+    for(int i = 0;i < len;i++)
+    {
+        char c = str[i];
+        if(c == '\\' && i+1 < len)
+        {
+            c = str[++i];
+            if(c == 'n')
+                c = '\n';
+            else if(c == 't')
+                c = '\t';
+            else if('0' <= c && c <= '7')
+            {
+                // Octal escaped byte (Eg: "\302")
+                int val = 0;
+                for(int j = 0;j < 3 && i < len && '0' <= str[i] && str[i] <= '7';j++)
+                    val = (val<<3) + (str[i++]-'0');
+                i--;
+                c = (char)val;
+            }
+        }
+        unescaped += c;
+    }
+    return QString::fromUtf8(unescaped.constData(), unescaped.size());
+}
+
@@ -22,12 +22,15 @@ QString getFilenamePart(QString fullPath);
 void dividePath(QString fullPath, QString *filename, QString *folderPath);
 
 unsigned char hexStringToU8(const char *str);
+int hexStringToBytes(const char *str, int len, unsigned char *data);
 long long stringToLongLong(const char* str);
 long long stringToLongLong(QString str);
 QString longLongToHexString(long long num);
 
 QString simplifyPath(QString path);
 
+QString unescapeCString(const char *str, int len);
+
 
 #endif // FILE__UTIL_H
 
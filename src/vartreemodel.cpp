@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#include "vartreemodel.h"
+
+#include <QBrush>
+#include <assert.h>
+
+
+VarItem::VarItem(VarItem *parent)
+    : m_address(0)
+    ,m_hasChildren(false)
+    ,m_canFetchMore(false)
+    ,m_isEditable(false)
+    ,m_isDisabled(false)
+    ,m_isChanged(false)
+    ,m_parent(parent)
+    ,m_row(0)
+{
+}
+
+
+VarItem::~VarItem()
+{
+    for(int i = 0;i < m_children.size();i++)
+        delete m_children[i];
+}
+
+
+
+
+VarTreeModel::VarTreeModel(IVarTreeModel *inf)
+    : m_inf(inf)
+    ,m_root(NULL)
+{
+}
+
+
+VarTreeModel::~VarTreeModel()
+{
+}
+
+
+VarItem *VarTreeModel::getItem(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return const_cast<VarItem*>(&m_root);
+    return static_cast<VarItem*>(index.internalPointer());
+}
+
+
+QModelIndex VarTreeModel::getIndex(VarItem *item, int column) const
+{
+    if(item == &m_root)
+        return QModelIndex();
+    return createIndex(item->m_row, column, item);
+}
+
+
+/**
+ * @brief Adds items last among the children of an item.
+ *
+ * The model takes the ownership of the items.
+ */
+void VarTreeModel::addItems(VarItem *parent, QList<VarItem*> items)
+{
+    if(items.isEmpty())
+        return;
+
+    int first = parent->m_children.size();
+    beginInsertRows(getIndex(parent), first, first+items.size()-1);
+    parent->m_children.reserve(first+items.size());
+    for(int i = 0;i < items.size();i++)
+    {
+        VarItem *item = items[i];
+        item->m_parent = parent;
+        item->m_row = first+i;
+        parent->m_children.append(item);
+    }
+    endInsertRows();
+}
+
+
+/**
+ * @brief Adds a new item last among the children of an item.
+ * @return The new item.
+ */
+VarItem *VarTreeModel::addItem(VarItem *parent, QString name, QString value, QString type)
+{
+    VarItem *item = new VarItem(parent);
+    item->m_name = name;
+    item->m_value = value;
+    item->m_type = type;
+
+    QList<VarItem*> items;
+    items.append(item);
+    addItems(parent, items);
+    return item;
+}
+
+
+/**
+ * @brief Removes and deletes an item and its children.
+ */
+void VarTreeModel::removeItem(VarItem *item)
+{
+    VarItem *parent = item->m_parent;
+    assert(parent != NULL);
+    int row = item->m_row;
+
+    beginRemoveRows(getIndex(parent), row, row);
+    parent->m_children.remove(row);
+    for(int i = row;i < parent->m_children.size();i++)
+        parent->m_children[i]->m_row = i;
+    endRemoveRows();
+
+    delete item;
+}
+
+
+/**
+ * @brief Removes and deletes the children of an item.
+ * @param first    Index of the first child to remove.
+ */
+void VarTreeModel::removeChildren(VarItem *parent, int first)
+{
+    int count = parent->m_children.size();
+    if(first >= count)
+        return;
+
+    beginRemoveRows(getIndex(parent), first, count-1);
+    for(int i = first;i < count;i++)
+        delete parent->m_children[i];
+    parent->m_children.resize(first);
+    endRemoveRows();
+}
+
+
+/**
+ * @brief Tells the views that the fields of an item has been changed.
+ */
+void VarTreeModel::itemChanged(VarItem *item)
+{
+    emit dataChanged(getIndex(item, 0), getIndex(item, m_headers.size()-1));
+}
+
+
+/**
+ * @brief Removes all items.
+ */
+void VarTreeModel::clear()
+{
+    beginResetModel();
+    for(int i = 0;i < m_root.m_children.size();i++)
+        delete m_root.m_children[i];
+    m_root.m_children.clear();
+    endResetModel();
+}
+
+
+QModelIndex VarTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    VarItem *parentItem = getItem(parent);
+    if(row < 0 || row >= parentItem->m_children.size())
+        return QModelIndex();
+    return createIndex(row, column, parentItem->m_children[row]);
+}
+
+
+QModelIndex VarTreeModel::parent(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return QModelIndex();
+    VarItem *item = getItem(index);
+    return getIndex(item->m_parent);
+}
+
+
+int VarTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.column() > 0)
+        return 0;
+    return getItem(parent)->m_children.size();
+}
+
+
+int VarTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return m_headers.size();
+}
+
+
+bool VarTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if(parent.column() > 0)
+        return false;
+    VarItem *item = getItem(parent);
+    return item->m_hasChildren || !item->m_children.isEmpty();
+}
+
+
+QVariant VarTreeModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid())
+        return QVariant();
+
+    VarItem *item = getItem(index);
+    if(role == Qt::ForegroundRole)
+    {
+        if(item->m_isChanged)
+            return QBrush(Qt::red);
+        return QVariant();
+    }
+    if(role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    switch(index.column())
+    {
+        case 0: return item->m_name;
+        case 1: return item->m_value;
+        case 2: return item->m_type;
+        default:;
+    }
+    return QVariant();
+}
+
+
+/**
+ * @brief Called when the name of an item has been edited in a view.
+ */
+bool VarTreeModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if(!index.isValid() || index.column() != 0 || role != Qt::EditRole)
+        return false;
+
+    m_inf->IVarTreeModel_onNameEdited(getItem(index), value.toString());
+    return true;
+}
+
+
+Qt::ItemFlags VarTreeModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return Qt::NoItemFlags;
+    VarItem *item = getItem(index);
+    Qt::ItemFlags flags = Qt::ItemIsSelectable;
+    if(!item->m_isDisabled)
+        flags |= Qt::ItemIsEnabled;
+    if(item->m_isEditable && index.column() == 0)
+        flags |= Qt::ItemIsEditable;
+    return flags;
+}
+
+
+QVariant VarTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal && role == Qt::DisplayRole && section < m_headers.size())
+        return m_headers[section];
+    return QVariant();
+}
+
+
+bool VarTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    return getItem(parent)->m_canFetchMore;
+}
+
+
+void VarTreeModel::fetchMore(const QModelIndex &parent)
+{
+    VarItem *item = getItem(parent);
+    if(item->m_canFetchMore)
+        m_inf->IVarTreeModel_onFetchMore(item);
+}
+
+
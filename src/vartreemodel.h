@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014-2015 Johan Henriksson.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ */
+
+#ifndef FILE__VAR_TREE_MODEL_H
+#define FILE__VAR_TREE_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+
+/**
+ * @brief A row in a VarTreeModel.
+ */
+class VarItem
+{
+public:
+    VarItem(VarItem *parent);
+    ~VarItem();
+
+    VarItem *getParent() const { return m_parent; };
+    int getRow() const { return m_row; };
+    int getChildCount() const { return m_children.size(); };
+    VarItem *getChild(int i) const { return m_children[i]; };
+
+public:
+    QString m_name;
+    QString m_value; //!< The value as it is displayed.
+    QString m_type;
+    QString m_key; //!< Identifies the variable (Eg: the path or the watch id).
+    long long m_address;
+    bool m_hasChildren; //!< True if the variable has children (even if they has not been added).
+    bool m_canFetchMore; //!< True if there are children that has not been added yet.
+    bool m_isEditable; //!< True if the name can be edited.
+    bool m_isDisabled;
+    bool m_isChanged; //!< True if the value is shown as changed.
+
+private:
+    VarItem *m_parent;
+    int m_row; //!< The index of the item among the children of the parent.
+    QVector<VarItem*> m_children;
+
+    friend class VarTreeModel;
+
+private:
+    VarItem(const VarItem &) {};
+};
+
+
+/**
+ * @brief Interface for the owner of a VarTreeModel.
+ */
+class IVarTreeModel
+{
+    public:
+    IVarTreeModel(){};
+
+    virtual void IVarTreeModel_onFetchMore(VarItem *item) = 0;
+    virtual void IVarTreeModel_onNameEdited(VarItem *item, QString name) = 0;
+};
+
+
+/**
+ * @brief Model of the variables in the local and the watch views.
+ *
+ * The children of a variable are added by the owner when the view asks
+ * for them (see IVarTreeModel_onFetchMore()), so only the rows that has
+ * been shown are ever created. The items are kept between the stops and
+ * are updated in place.
+ */
+class VarTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    VarTreeModel(IVarTreeModel *inf);
+    ~VarTreeModel();
+
+    void setHeaders(QStringList headers) { m_headers = headers; };
+
+    VarItem *getRoot() { return &m_root; };
+    VarItem *getItem(const QModelIndex &index) const;
+    QModelIndex getIndex(VarItem *item, int column = 0) const;
+
+    void addItems(VarItem *parent, QList<VarItem*> items);
+    VarItem *addItem(VarItem *parent, QString name, QString value, QString type = "");
+    void removeItem(VarItem *item);
+    void removeChildren(VarItem *parent, int first = 0);
+    void itemChanged(VarItem *item);
+    void clear();
+
+    // QAbstractItemModel
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+private:
+    IVarTreeModel *m_inf;
+    VarItem m_root;
+    QStringList m_headers;
+};
+
+
+#endif // FILE__VAR_TREE_MODEL_H
@@ -5,36 +5,36 @@
  * This software may be modified and distributed under the terms
  * of the BSD license.  See the LICENSE file for details.
  */
- 
+
 #include "watchvarctl.h"
 
 #include "log.h"
 #include "util.h"
 #include "core.h"
+#include <QSet>
 
 
 WatchVarCtl::WatchVarCtl()
+    : m_varWidget(NULL)
+    ,m_model(this)
 {
-
+    QStringList names;
+    names += "Name";
+    names += "Value";
+    names += "Type";
+    m_model.setHeaders(names);
 
 }
 
-void WatchVarCtl::setWidget(QTreeWidget *varWidget)
+void WatchVarCtl::setWidget(QTreeView *varWidget)
 {
     m_varWidget = varWidget;
 
         //
-    m_varWidget->setColumnCount(3);
+    m_varWidget->setModel(&m_model);
     m_varWidget->setColumnWidth(0, 120);
-    QStringList names;
-    names += "Name";
-    names += "Value";
-    names += "Type";
-    m_varWidget->setHeaderLabels(names);
-    connect(m_varWidget, SIGNAL(itemChanged(QTreeWidgetItem * ,int)), this, SLOT(onWatchWidgetCurrentItemChanged(QTreeWidgetItem * ,int)));
-    connect(m_varWidget, SIGNAL(itemDoubleClicked( QTreeWidgetItem * , int  )), this, SLOT(onWatchWidgetItemDoubleClicked(QTreeWidgetItem *, int )));
-    connect(m_varWidget, SIGNAL(itemExpanded( QTreeWidgetItem * )), this, SLOT(onWatchWidgetItemExpanded(QTreeWidgetItem * )));
-    connect(m_varWidget, SIGNAL(itemCollapsed( QTreeWidgetItem *)), this, SLOT(onWatchWidgetItemCollapsed(QTreeWidgetItem *)));
+    connect(m_varWidget, SIGNAL(doubleClicked( const QModelIndex & )), this, SLOT(onWatchWidgetItemDoubleClicked(const QModelIndex & )));
+    connect(m_varWidget, SIGNAL(expanded( const QModelIndex & )), this, SLOT(onWatchWidgetItemExpanded(const QModelIndex & )));
 
 
     fillInVars();
@@ -44,136 +44,91 @@ void WatchVarCtl::setWidget(QTreeWidget *varWidget)
 
 
 
-         
+
 void WatchVarCtl::ICore_onWatchVarChildAdded(QString watchId, QString name, QString valueString, QString varType, bool hasChildren)
 {
-    QTreeWidget *varWidget = m_varWidget;
-    QStringList names;
+    VarItem *item = m_items.value(watchId, NULL);
 
-    Q_UNUSED(name);
+    // Did not find one
+    if(item == NULL)
+    {
+        debugMsg("Adding %s=%s", stringToCStr(name), stringToCStr(valueString));
+
+        // Find the parent (Eg: "var1.a" for "var1.a.b")
+        VarItem *parentItem = m_model.getRoot();
+        int divPos = watchId.lastIndexOf('.');
+        if(divPos != -1)
+            parentItem = m_items.value(watchId.left(divPos), parentItem);
+
+        // Create the item
+        item = new VarItem(parentItem);
+        item->m_name = name;
+        item->m_type = varType;
+        item->m_key = watchId;
+        item->m_hasChildren = hasChildren;
+        item->m_canFetchMore = hasChildren;
+        m_items[watchId] = item;
+
+        QList<VarItem*> items;
+        items.append(item);
+        m_model.addItems(parentItem, items);
+    }
 
-    //
-    QTreeWidgetItem * rootItem = varWidget->invisibleRootItem();
-    QStringList watchIdParts = watchId.split('.');
-    QString thisWatchId;
-    for(int partIdx = 0; partIdx < watchIdParts.size();partIdx++)
+    // Update the text
+    if(m_watchVarDispInfo.contains(watchId))
     {
-        // Get the watchid to look for
-        if(thisWatchId != "")
-            thisWatchId += ".";
-        thisWatchId += watchIdParts[partIdx];
-
-        // Look for the item with the specified watchId
-        QTreeWidgetItem* foundItem = NULL;
-        for(int i = 0;foundItem == NULL && i < rootItem->childCount();i++)
-        {
-            QTreeWidgetItem* item =  rootItem->child(i);
-            QString itemKey = item->data(0, Qt::UserRole).toString();
+        VarCtl::DispInfo &dispInfo = m_watchVarDispInfo[watchId];
+        dispInfo.orgValue = valueString;
 
-            if(thisWatchId == itemKey)
-            {
-                foundItem = item;
-            }
-        }
+        VarCtl::DispFormat orgFormat = VarCtl::findVarType(valueString);
 
-        // Did not find one
-        QTreeWidgetItem *item;
-        if(foundItem == NULL)
-        {
-            debugMsg("Adding %s=%s", stringToCStr(name), stringToCStr(valueString));
-
-            // Create the item
-            QStringList nameList;
-            nameList += name;
-            nameList += valueString;
-            nameList += varType;
-            item = new QTreeWidgetItem(nameList);
-            item->setData(0, Qt::UserRole, thisWatchId);
-            item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            rootItem->addChild(item);
-            rootItem = item;
-
-            if(hasChildren)
-                rootItem->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
-
-            
-        
-        }
-        else
-        {
-            item = foundItem;
-            rootItem = foundItem;
-        }
+        dispInfo.orgFormat = orgFormat;
 
-        // The last part of the id?
-        if(partIdx+1 == watchIdParts.size())
+        // Update the variable value
+        if(orgFormat == VarCtl::DISP_DEC)
         {
-            // Update the text
-            if(m_watchVarDispInfo.contains(thisWatchId))
-            {
-                VarCtl::DispInfo &dispInfo = m_watchVarDispInfo[thisWatchId];
-                dispInfo.orgValue = valueString;
-
-                VarCtl::DispFormat orgFormat = VarCtl::findVarType(valueString);
-
-                dispInfo.orgFormat = orgFormat;
-                
-                // Update the variable value
-                if(orgFormat == VarCtl::DISP_DEC)
-                {
-                    valueString = VarCtl::valueDisplay(valueString.toLongLong(0,0), dispInfo.dispFormat);
-                }
-            }
-            if(item->childCount() != 0)
-            {
-                if(!hasChildren)
-                    item->setDisabled(true);
-                else
-                    item->setDisabled(false);
-                
-
-            }
-            item->setText(1, valueString);
+            valueString = VarCtl::valueDisplay(valueString.toLongLong(0,0), dispInfo.dispFormat);
         }
     }
+    if(item->getChildCount() != 0)
+        item->m_isDisabled = !hasChildren;
+    item->m_value = valueString;
+    m_model.itemChanged(item);
 }
 
 
 
-void 
-WatchVarCtl::onWatchWidgetCurrentItemChanged( QTreeWidgetItem * current, int column )
+/**
+ * @brief Called when the name of a watch has been edited.
+ */
+void WatchVarCtl::IVarTreeModel_onNameEdited(VarItem *current, QString newName)
 {
-    QTreeWidget *varWidget = m_varWidget;
     Core &core = Core::getInstance();
-    QString oldKey = current->data(0, Qt::UserRole).toString();
+    QString oldKey = current->m_key;
     QString oldName  = oldKey == "" ? "" : core.gdbGetVarWatchName(oldKey);
-    QString newName = current->text(0);
-
-    if(column != 0)
-        return;
 
     if(oldKey != "" && oldName == newName)
         return;
-    
+
     debugMsg("oldKey:'%s' oldName:'%s' newName:'%s' ", stringToCStr(oldKey), stringToCStr(oldName), stringToCStr(newName));
 
     if(newName == "...")
         newName = "";
     if(oldName == "...")
         oldName = "";
-        
+
     // Nothing to do?
     if(oldName == "" && newName == "")
     {
-        current->setText(0, "...");
-        current->setText(1, "");
-        current->setText(2, "");
+        current->m_name = "...";
+        current->m_value = "";
+        current->m_type = "";
+        m_model.itemChanged(current);
     }
     // Remove a variable?
     else if(newName.isEmpty())
     {
-        QTreeWidgetItem *rootItem = varWidget->invisibleRootItem();
-        rootItem->removeChild(current);
+        removeWatchItem(current);
 
         core.gdbRemoveVarWatch(oldKey);
 
@@ -182,54 +137,39 @@ WatchVarCtl::onWatchWidgetCurrentItemChanged( QTreeWidgetItem * current, int col
     // Add a new variable?
     else if(oldName == "")
     {
-        //debugMsg("%s", stringToCStr(current->text(0)));
+        //debugMsg("%s", stringToCStr(newName));
         QString value;
         QString watchId;
         QString varType;
         bool hasChildren = false;
         if(core.gdbAddVarWatch(newName, &varType, &value, &watchId, &hasChildren) == 0)
         {
-            if(hasChildren)
-                current->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
-            current->setData(0, Qt::UserRole, watchId);
-            current->setText(1, value);
-            current->setText(2, varType);
-
-            VarCtl::DispInfo dispInfo;
-            dispInfo.orgValue = value;
-            dispInfo.orgFormat = VarCtl::findVarType(value);
-            dispInfo.dispFormat = dispInfo.orgFormat;
-            m_watchVarDispInfo[watchId] = dispInfo;
+            current->m_name = newName;
+            setWatch(current, watchId, value, varType, hasChildren);
 
             // Create a new dummy item
-            QTreeWidgetItem *item;
-            QStringList names;
-            names += "...";
-            item = new QTreeWidgetItem(names);
-            item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable);
-            varWidget->addTopLevelItem(item);
-            
+            addDummyItem();
+
         }
         else
         {
-            current->setText(0, "...");
-            current->setText(1, "");
-            current->setText(2, "");
+            current->m_name = "...";
+            current->m_value = "";
+            current->m_type = "";
+            m_model.itemChanged(current);
         }
-    
+
     }
     // Change a existing variable?
     else
     {
-        //debugMsg("'%s' -> %s", stringToCStr(current->text(0)), stringToCStr(current->text(0)));
+        //debugMsg("'%s' -> %s", stringToCStr(oldName), stringToCStr(newName));
 
         // Remove any children
-        while(current->childCount())
-        {
-            QTreeWidgetItem *childItem =  current->takeChild(0);
-            delete childItem;
-        }
-        
+        for(int i = 0;i < current->getChildCount();i++)
+            forgetItem(current->getChild(i));
+        m_model.removeChildren(current);
+        m_items.remove(oldKey);
 
         // Remove old watch
         core.gdbRemoveVarWatch(oldKey);
@@ -242,69 +182,103 @@ WatchVarCtl::onWatchWidgetCurrentItemChanged( QTreeWidgetItem * current, int col
         bool hasChildren = false;
         if(core.gdbAddVarWatch(newName, &varType, &value, &watchId, &hasChildren) == 0)
         {
-            current->setData(0, Qt::UserRole, watchId);
-            current->setText(1, value);
-            current->setText(2, varType);
+            current->m_name = newName;
+            setWatch(current, watchId, value, varType, hasChildren);
 
-            if(hasChildren)
-            {
-                current->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
-            }
-            core.gdbExpandVarWatchChildren(watchId);
-            
-            // Add display information
-            VarCtl::DispInfo dispInfo;
-            dispInfo.orgValue = value;
-            dispInfo.orgFormat = VarCtl::findVarType(value);
-            dispInfo.dispFormat = dispInfo.orgFormat;
-            m_watchVarDispInfo[watchId] = dispInfo;
-            
+            // The view only asks for the children of items that it expands
+            if(m_varWidget->isExpanded(m_model.getIndex(current)))
+                m_model.fetchMore(m_model.getIndex(current));
         }
         else
         {
-            QTreeWidgetItem *rootItem = varWidget->invisibleRootItem();
-            rootItem->removeChild(current);
+            removeWatchItem(current);
         }
     }
 
 }
 
 
+/**
+ * @brief Sets the variable that an item is showing.
+ */
+void WatchVarCtl::setWatch(VarItem *item, QString watchId, QString value, QString varType, bool hasChildren)
+{
+    item->m_key = watchId;
+    item->m_value = value;
+    item->m_type = varType;
+    item->m_hasChildren = hasChildren;
+    item->m_canFetchMore = hasChildren;
+    m_items[watchId] = item;
+    m_model.itemChanged(item);
+
+    // Add display information
+    VarCtl::DispInfo dispInfo;
+    dispInfo.orgValue = value;
+    dispInfo.orgFormat = VarCtl::findVarType(value);
+    dispInfo.dispFormat = dispInfo.orgFormat;
+    m_watchVarDispInfo[watchId] = dispInfo;
+}
+
 
-void WatchVarCtl::onWatchWidgetItemExpanded(QTreeWidgetItem *item )
+/**
+ * @brief Removes an item from the watch id index (including its children).
+ */
+void WatchVarCtl::forgetItem(VarItem *item)
 {
-    Core &core = Core::getInstance();
-    //QTreeWidget *varWidget = m_varWidget;
+    for(int i = 0;i < item->getChildCount();i++)
+        forgetItem(item->getChild(i));
+    if(!item->m_key.isEmpty())
+        m_items.remove(item->m_key);
+}
 
-    // Get watchid of the item
-    QString watchId = item->data(0, Qt::UserRole).toString();
 
+void WatchVarCtl::removeWatchItem(VarItem *item)
+{
+    forgetItem(item);
+    m_model.removeItem(item);
+}
 
-    // Get the children
-    core.gdbExpandVarWatchChildren(watchId);
-    
 
+/**
+ * @brief Gets the next page of children of an item that has been expanded.
+ *
+ * GDB only has to print the values of the children in the page, so huge
+ * arrays are shown quickly and the rest is fetched as the view is scrolled.
+ */
+void WatchVarCtl::IVarTreeModel_onFetchMore(VarItem *item)
+{
+    Core &core = Core::getInstance();
+
+    item->m_canFetchMore = false;
+
+    // Get the children
+    int from = item->getChildCount();
+    item->m_canFetchMore = core.gdbExpandVarWatchChildren(item->m_key, from, PAGE_SIZE);
 }
 
-void WatchVarCtl::onWatchWidgetItemCollapsed(QTreeWidgetItem *item)
+
+void WatchVarCtl::onWatchWidgetItemExpanded(const QModelIndex &index)
 {
-    Q_UNUSED(item);
-    
+    // The view does not fetch the children of items that are expanded
+    // while it has a layout pending.
+    VarItem *item = m_model.getItem(index);
+    if(item->m_canFetchMore && item->getChildCount() == 0)
+        IVarTreeModel_onFetchMore(item);
 }
 
 
 
-void WatchVarCtl::onWatchWidgetItemDoubleClicked(QTreeWidgetItem *item, int column)
+void WatchVarCtl::onWatchWidgetItemDoubleClicked(const QModelIndex &index)
 {
-    QTreeWidget *varWidget = m_varWidget;
+    QTreeView *varWidget = m_varWidget;
+    VarItem *item = m_model.getItem(index);
+
 
-    
-    if(column == 0)
-        varWidget->editItem(item,column);
-    else if(column == 1)
+    if(index.column() == 0)
+        varWidget->edit(index);
+    else if(index.column() == 1)
     {
-        QString varName = item->text(0);
-        QString watchId = item->data(0, Qt::UserRole).toString();
+        QString watchId = item->m_key;
 
         if(m_watchVarDispInfo.contains(watchId))
         {
@@ -330,33 +304,31 @@ void WatchVarCtl::onWatchWidgetItemDoubleClicked(QTreeWidgetItem *item, int colu
                     dispInfo.dispFormat = VarCtl::DISP_DEC;
                 }
 
-                QString valueText = VarCtl::valueDisplay(val, dispInfo.dispFormat);
-
-                item->setText(1, valueText);
+                item->m_value = VarCtl::valueDisplay(val, dispInfo.dispFormat);
+                m_model.itemChanged(item);
             }
         }
     }
 }
 
 
-     
-void WatchVarCtl::fillInVars()
+/**
+ * @brief Adds the item ("...") that a new watch is entered in.
+ */
+VarItem *WatchVarCtl::addDummyItem()
 {
-    QTreeWidget *varWidget = m_varWidget;
-    QTreeWidgetItem *item;
-    QStringList names;
-    
-    varWidget->clear();
-
+    VarItem *item = m_model.addItem(m_model.getRoot(), "...", "");
+    item->m_isEditable = true;
+    return item;
+}
 
 
-    names.clear();
-    names += "...";
-    item = new QTreeWidgetItem(names);
-    item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable);
-    varWidget->insertTopLevelItem(0, item);
-   
+void WatchVarCtl::fillInVars()
+{
+    m_model.clear();
+    m_items.clear();
 
+    addDummyItem();
 }
 
 
@@ -367,48 +339,43 @@ void WatchVarCtl::fillInVars()
 void WatchVarCtl::addNewWatch(QString varName)
 {
     // Add the new variable to the watch list
-    QTreeWidgetItem* rootItem = m_varWidget->invisibleRootItem();
-    QTreeWidgetItem* lastItem = rootItem->child(rootItem->childCount()-1);
-    lastItem->setText(0, varName);
+    VarItem *rootItem = m_model.getRoot();
+    VarItem *lastItem = rootItem->getChild(rootItem->getChildCount()-1);
+    IVarTreeModel_onNameEdited(lastItem, varName);
 
 }
 
 void WatchVarCtl::deleteSelected()
 {
-    QTreeWidgetItem *rootItem = m_varWidget->invisibleRootItem();
-        
-    QList<QTreeWidgetItem *> items = m_varWidget->selectedItems();
+    QModelIndexList indexes = m_varWidget->selectionModel()->selectedRows();
 
     // Get the root item for each item in the list
-    for(int i =0;i < items.size();i++)
+    QSet<VarItem *> itemSet;
+    for(int i =0;i < indexes.size();i++)
     {
-        QTreeWidgetItem *item = items[i];
-        while(item->parent() != NULL)
+        VarItem *item = m_model.getItem(indexes[i]);
+        while(item->getParent() != m_model.getRoot())
         {
-            item = item->parent();
+            item = item->getParent();
         }
-        items[i] = item;
+        itemSet.insert(item);
     }
 
     // Loop through the items
-    QSet<QTreeWidgetItem *> itemSet = items.toSet();
-    QSet<QTreeWidgetItem *>::const_iterator setItr = itemSet.constBegin();
+    QSet<VarItem *>::const_iterator setItr = itemSet.constBegin();
     for (;setItr != itemSet.constEnd();++setItr)
     {
-        QTreeWidgetItem *item = *setItr;
-    
+        VarItem *item = *setItr;
+
         // Delete the item
         Core &core = Core::getInstance();
-        QString watchId = item->data(0, Qt::UserRole).toString();
+        QString watchId = item->m_key;
         if(watchId != "")
         {
-            rootItem->removeChild(item);
+            removeWatchItem(item);
             core.gdbRemoveVarWatch(watchId);
         }
     }
 
 }
 
-    
-
-    
@@ -11,37 +11,48 @@
 
 #include <QObject>
 #include <QString>
-#include <QTreeWidget>
+#include <QHash>
+#include <QTreeView>
 
 #include "varctl.h"
+#include "vartreemodel.h"
 
 
-class WatchVarCtl : public VarCtl
+class WatchVarCtl : public VarCtl, public IVarTreeModel
 {
     Q_OBJECT
 
 public:
     WatchVarCtl();
-    
-    void setWidget(QTreeWidget *varWidget);
+
+    void setWidget(QTreeView *varWidget);
 
     void ICore_onWatchVarChildAdded(QString watchId_, QString name, QString valueString, QString varType, bool hasChildren);
     void addNewWatch(QString varName);
     void deleteSelected();
 
+    void IVarTreeModel_onFetchMore(VarItem *item);
+    void IVarTreeModel_onNameEdited(VarItem *item, QString name);
+
 public slots:
-    void onWatchWidgetItemDoubleClicked(QTreeWidgetItem *item, int column);
-    void onWatchWidgetCurrentItemChanged ( QTreeWidgetItem * current, int column );
-    void onWatchWidgetItemExpanded(QTreeWidgetItem *item );
-    void onWatchWidgetItemCollapsed(QTreeWidgetItem *item);
+    void onWatchWidgetItemDoubleClicked(const QModelIndex &index);
+    void onWatchWidgetItemExpanded(const QModelIndex &index);
 
 
 private:
+    enum { PAGE_SIZE = 1000 }; //!< Number of children to get from GDB at a time.
+
     void fillInVars();
+    VarItem *addDummyItem();
+    void setWatch(VarItem *item, QString watchId, QString value, QString varType, bool hasChildren);
+    void removeWatchItem(VarItem *item);
+    void forgetItem(VarItem *item);
 
 private:
-    QTreeWidget *m_varWidget;
+    QTreeView *m_varWidget;
     VarCtl::DispInfoMap m_watchVarDispInfo;
+    VarTreeModel m_model;
+    QHash<QString, VarItem*> m_items; //!< The items indexed by their watch id.
 };
 
 #endif // WATCHVAR_CTL_H
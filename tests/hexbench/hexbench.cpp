@@ -0,0 +1,195 @@
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * @brief The decoding used by Core::gdbGetMemory() before hexStringToBytes().
+ *
+ * Kept here so that the two can be compared on the same input.
+ */
+static void legacyDecode(QString dataStr, QByteArray *data)
+{
+    data->clear();
+
+    QByteArray dataByteArray = dataStr.toLocal8Bit();
+    const char *dataCStr = dataByteArray.constData();
+    int dataCStrLen = strlen(dataCStr);
+    for(int i = 0;i+1 < dataCStrLen;i+=2)
+    {
+        unsigned char dataByte = hexStringToU8(dataCStr+i);
+
+        data->push_back(dataByte);
+    }
+}
+
+
+/**
+ * @brief Checks that hexStringToBytes() decodes a string to the expected bytes.
+ * @return true if it did.
+ */
+static bool checkDecode(const char *name, const QByteArray &hexStr, const QByteArray &expected)
+{
+    QByteArray data;
+    data.resize(hexStr.size()/2+1);
+    int len = hexStringToBytes(hexStr.constData(), hexStr.size(), (unsigned char*)data.data());
+    data.resize(len);
+    if(data != expected)
+    {
+        printf("FAILED: %s (\"%s\" decoded to %d bytes, expected %d)\n", name,
+            hexStr.constData(), len, expected.size());
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Checks the cases that hexStringToBytes() handles besides plain lower case digits.
+ * @return The number of failed checks.
+ */
+static int runChecks()
+{
+    int failCount = 0;
+
+    // 40 bytes, so that it is decoded both 16 bytes at a time and in the scalar tail
+    const char *digits = "0123456789abcdef0123456789ABCDEF";
+    QByteArray hexStr;
+    QByteArray bytes;
+    for(int i = 0;i < 40;i++)
+    {
+        unsigned char b = (i*37+11)&0xff;
+        hexStr += digits[(b>>4) + (i%2)*16];
+        hexStr += digits[(b&0xf) + ((i/2)%2)*16];
+        bytes += (char)b;
+    }
+    if(!checkDecode("mixed case", hexStr, bytes))
+        failCount++;
+    if(!checkDecode("upper case", hexStr.toUpper(), bytes))
+        failCount++;
+    if(!checkDecode("empty", "", ""))
+        failCount++;
+    if(!checkDecode("odd length", hexStr.left(hexStr.size()-1), bytes.left(bytes.size()-1)))
+        failCount++;
+    if(!checkDecode("odd length (one block)", hexStr.left(33), bytes.left(16)))
+        failCount++;
+
+    // Decoding stops at the first pair with a non hex digit (wherever it is)
+    const char badChars[] = { '/', ':', '@', 'G', '`', 'g', ' ', '\0', (char)0xc1 };
+    for(int pos = 0;pos < hexStr.size();pos++)
+    {
+        for(int b = 0;b < (int)sizeof(badChars);b++)
+        {
+            QByteArray badStr = hexStr;
+            badStr[pos] = badChars[b];
+            QByteArray name = QString("invalid char 0x%1 at %2").arg((int)(unsigned char)badChars[b], 0, 16).arg(pos).toLatin1();
+            if(!checkDecode(name.constData(), badStr, bytes.left(pos/2)))
+                failCount++;
+        }
+    }
+
+    return failCount;
+}
+
+
+int dumpUsage()
+{
+    printf("Usage: ./hexbench [-n COUNT] [-s SIZE]\n");
+    printf("Description:\n");
+    printf("  Measures the speed of decoding the hex strings of -data-read-memory-bytes.\n");
+    printf("  Upper case, odd length and invalid strings are checked first.\n");
+    printf("  -s is the number of bytes to decode (Eg: 4194304).\n");
+    return 1;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc,argv);
+    int loopCount = 10;
+    int byteCount = 4*1024*1024;
+
+    // Parse arguments
+    for(int i = 1;i < argc;i++)
+    {
+        const char *curArg = argv[i];
+        if(strcmp(curArg, "-n") == 0 && i+1 < argc)
+            loopCount = atoi(argv[++i]);
+        else if(strcmp(curArg, "-s") == 0 && i+1 < argc)
+            byteCount = atoi(argv[++i]);
+        else
+            return dumpUsage();
+    }
+    if(loopCount <= 0 || byteCount <= 0)
+        return dumpUsage();
+
+    int failCount = runChecks();
+
+    // Create the hex string of a memory area with random contents
+    QByteArray expected;
+    QByteArray hexStr;
+    expected.resize(byteCount);
+    hexStr.resize(byteCount*2);
+    srand(1);
+    for(int i = 0;i < byteCount;i++)
+    {
+        const char *digits = "0123456789abcdef";
+        unsigned char b = rand();
+        expected[i] = b;
+        hexStr[i*2] = digits[b>>4];
+        hexStr[i*2+1] = digits[b&0xf];
+    }
+    QString hexQStr = QString::fromLatin1(hexStr.constData(), hexStr.size());
+
+    // Legacy decoding
+    QElapsedTimer timer;
+    QByteArray legacyData;
+    timer.start();
+    for(int loopIdx = 0;loopIdx < loopCount;loopIdx++)
+        legacyDecode(hexQStr, &legacyData);
+    double legacySecs = timer.nsecsElapsed()/1e9;
+
+    // Bulk decoding
+    QByteArray data;
+    timer.start();
+    for(int loopIdx = 0;loopIdx < loopCount;loopIdx++)
+    {
+        data.resize(hexStr.size()/2);
+        data.resize(hexStringToBytes(hexStr.constData(), hexStr.size(), (unsigned char*)data.data()));
+    }
+    double bulkSecs = timer.nsecsElapsed()/1e9;
+
+    if(legacyData != expected)
+    {
+        printf("FAILED: legacy decoding differs\n");
+        failCount++;
+    }
+    if(data != expected)
+    {
+        printf("FAILED: bulk decoding differs\n");
+        failCount++;
+    }
+
+    double gigaBytes = (double)byteCount*loopCount/1e9;
+#ifdef __SSE2__
+    printf("Input: %d bytes (SSE2)\n", byteCount);
+#else
+    printf("Input: %d bytes (scalar)\n", byteCount);
+#endif
+    printf("legacy: %8.3f s  %8.3f GB/s\n", legacySecs, gigaBytes/legacySecs);
+    printf("bulk:   %8.3f s  %8.3f GB/s\n", bulkSecs, gigaBytes/bulkSecs);
+    printf("speedup: %.1fx\n", legacySecs/bulkSecs);
+
+    if(failCount > 0)
+    {
+        printf("%d checks failed\n", failCount);
+        return 1;
+    }
+    return 0;
+}
+
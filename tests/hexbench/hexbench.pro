@@ -0,0 +1,18 @@
+
+QT += core
+
+TEMPLATE = app
+
+SOURCES+=hexbench.cpp
+
+SOURCES+=../../src/util.cpp
+HEADERS+=../../src/util.h
+
+
+
+QMAKE_CXXFLAGS += -I../../src  -O2
+
+
+TARGET=hexbench
+
+
@@ -0,0 +1,255 @@
+#include "com.h"
+#include "log.h"
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <ctype.h>
+
+
+/**
+ * @brief The tokenizer used before the token arena was introduced.
+ *
+ * Kept here so that the two can be compared on the same input.
+ */
+class LegacyToken
+{
+public:
+    LegacyToken(Token::Type type) : m_type(type) {};
+
+    Token::Type m_type;
+    char m_tmpBuff[128];
+    QString text;
+};
+
+
+static QList<LegacyToken*> legacyTokenize(QString str)
+{
+    enum { IDLE, END_CODE, STRING, VAR} state = IDLE;
+    QList<LegacyToken*> list;
+    LegacyToken *cur = NULL;
+    QChar prevC = ' ';
+    
+    if(str.isEmpty())
+        return list;
+
+    for(int i = 0;i < str.size();i++)
+    {
+        QChar c = str[i];
+        switch(state)
+        {
+            case IDLE:
+            {
+                if(c == '"')
+                {
+                    cur = new LegacyToken(Token::C_STRING);
+                    list.push_back(cur);
+                    state = STRING;
+                }
+                else if(c == '(')
+                {
+                    cur = new LegacyToken(Token::END_CODE);
+                    list.push_back(cur);
+                    cur->text += c;
+                    state = END_CODE;
+                }
+                else if(c == '=' || c == '{' || c == '}' || c == ',' ||
+                    c == '[' || c == ']' || c == '+' || c == '^' ||
+                    c == '~' || c == '@' || c == '&' || c == '*')
+                {
+                    cur = new LegacyToken(Token::UNKNOWN);
+                    list.push_back(cur);
+                    cur->text += c;
+                    state = IDLE;
+                }
+                else if( c != ' ')
+                {
+                    cur = new LegacyToken(Token::VAR);
+                    list.push_back(cur);
+                    cur->text = c;
+                    state = VAR;
+                }
+            };break;
+            case END_CODE:
+            {
+                QString codeEndStr = "(gdb)";
+                cur->text += c;
+
+                if(cur->text.length() == codeEndStr.length())
+                    state = IDLE;
+                else if(cur->text.compare(codeEndStr.left(cur->text.length())) != 0)
+                {
+                    cur->m_type = Token::VAR;
+                    state = IDLE;
+                }
+            };break;
+            case STRING:
+            {
+                if(prevC != '\\' && c == '\\')
+                {
+                }
+                else if(prevC == '\\')
+                {
+                    if(c == 'n')
+                        cur->text += '\n';
+                    else
+                        cur->text += c;
+                }
+                else if(c == '"')
+                    state = IDLE;
+                else
+                    cur->text += c;
+            };break;
+            case VAR:
+            {
+                if(c == '=' || c == ',' || c == '{' || c == '}')
+                {
+                    i--;
+                    cur->text = cur->text.trimmed();
+                    state = IDLE;
+                }
+                else
+                    cur->text += c;
+            };break;
+        }
+        prevC = c;
+    }
+    if(cur)
+    {
+        if(cur->m_type == Token::VAR)
+            cur->text = cur->text.trimmed();
+    }
+    return list;
+}
+
+
+int dumpUsage()
+{
+    printf("Usage: ./mibench [-n COUNT] GDB_LOG_FILE\n");
+    printf("Description:\n");
+    printf("  Measures the MI tokenizer speed on recorded GDB output.\n");
+    printf("  The input is either raw MI output or a log written with ENABLE_GDB_LOG.\n");
+    return 1;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc,argv);
+    const char *inputFilename = NULL;
+    int loopCount = 10;
+
+    // Parse arguments
+    for(int i = 1;i < argc;i++)
+    {
+        const char *curArg = argv[i];
+        if(strcmp(curArg, "-n") == 0 && i+1 < argc)
+            loopCount = atoi(argv[++i]);
+        else if(curArg[0] == '-')
+            return dumpUsage();
+        else
+            inputFilename = curArg;
+    }
+    if(inputFilename == NULL || loopCount <= 0)
+        return dumpUsage();
+
+    // Open file
+    QFile file(inputFilename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        printf("Unable to open %s\n", inputFilename);
+        return 1;
+    }
+
+    // Read all MI rows
+    QList<QByteArray> rows;
+    long long byteCount = 0;
+    while (!file.atEnd())
+    {
+        QByteArray line = file.readLine();
+        while(line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        if(line.startsWith("<< "))
+            continue;
+        if(line.startsWith(">> "))
+            line = line.mid(3);
+
+        // Skip the command token (Eg: "12^done") since the legacy tokenizer did not split it from the record
+        int tokenLen = 0;
+        while(tokenLen < line.size() && isdigit(line.at(tokenLen)))
+            tokenLen++;
+        line = line.mid(tokenLen);
+
+        if(line.isEmpty())
+            continue;
+        rows.push_back(line);
+        byteCount += line.size();
+    }
+    if(rows.isEmpty())
+    {
+        printf("No MI output found in %s\n", inputFilename);
+        return 1;
+    }
+    
+    // Legacy tokenizer
+    QElapsedTimer timer;
+    long long legacyTokenCount = 0;
+    timer.start();
+    for(int loopIdx = 0;loopIdx < loopCount;loopIdx++)
+    {
+        for(int r = 0;r < rows.size();r++)
+        {
+            QList<LegacyToken*> list = legacyTokenize(QString(rows[r]));
+            legacyTokenCount += list.size();
+            for(int t = 0;t < list.size();t++)
+                delete list[t];
+        }
+    }
+    double legacySecs = timer.nsecsElapsed()/1e9;
+
+    // Arena tokenizer
+    TokenArena arena;
+    long long tokenCount = 0;
+    long long textLen = 0;
+    timer.start();
+    for(int loopIdx = 0;loopIdx < loopCount;loopIdx++)
+    {
+        for(int r = 0;r < rows.size();r++)
+        {
+            const QByteArray &row = rows[r];
+            arena.holdBuffer(row);
+            Com::tokenize(&arena, row.constData(), row.size());
+            tokenCount += arena.count();
+            arena.reset();
+        }
+    }
+    double arenaSecs = timer.nsecsElapsed()/1e9;
+
+    // Arena tokenizer when the text of all tokens are read as well
+    timer.start();
+    for(int loopIdx = 0;loopIdx < loopCount;loopIdx++)
+    {
+        for(int r = 0;r < rows.size();r++)
+        {
+            const QByteArray &row = rows[r];
+            arena.holdBuffer(row);
+            Com::tokenize(&arena, row.constData(), row.size());
+            for(int t = 0;t < arena.count();t++)
+                textLen += arena.at(t)->getString().length();
+            arena.reset();
+        }
+    }
+    double arenaTextSecs = timer.nsecsElapsed()/1e9;
+    
+    printf("Input: %d rows, %lld bytes, %lld tokens\n", rows.size(), byteCount, tokenCount/loopCount);
+    if(legacyTokenCount != tokenCount)
+        printf("Warning: legacy tokenizer found %lld tokens\n", legacyTokenCount/loopCount);
+    printf("legacy:               %8.3f s  %12.0f tokens/s\n", legacySecs, legacyTokenCount/legacySecs);
+    printf("arena:                %8.3f s  %12.0f tokens/s\n", arenaSecs, tokenCount/arenaSecs);
+    printf("arena (text decoded): %8.3f s  %12.0f tokens/s\n", arenaTextSecs, tokenCount/arenaTextSecs);
+    printf("speedup: %.1fx\n", legacySecs/arenaSecs);
+    
+    return 0;
+}
+
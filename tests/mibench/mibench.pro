@@ -0,0 +1,33 @@
+
+QT += core
+
+TEMPLATE = app
+
+SOURCES+=mibench.cpp
+
+SOURCES+=../../src/com.cpp
+HEADERS+=../../src/com.h
+
+SOURCES+=../../src/linebuffer.cpp
+HEADERS+=../../src/linebuffer.h
+
+SOURCES+=../../src/tree.cpp
+HEADERS+=../../src/tree.h
+
+SOURCES+=../../src/atom.cpp
+HEADERS+=../../src/atom.h
+
+SOURCES+=../../src/log.cpp
+HEADERS+=../../src/log.h
+SOURCES+=../../src/util.cpp
+HEADERS+=../../src/util.h
+
+
+
+QMAKE_CXXFLAGS += -I../../src  -O2
+
+
+TARGET=mibench
+
+
+